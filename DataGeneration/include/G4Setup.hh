@@ -26,16 +26,18 @@ class G4Material;
 
 /**
   * The method that builds and pre-initialises a `Geant4` detector with the given
-  * list of materials and secondary production threshold.
+  * list of materials, secondary production threshold and MSC range factor.
   *
   * The materials, that the detector will contain, are determined by the material
   * names given in the input argument. The secondary production threshold (in
-  * [mm] units) can also be given.
+  * [mm] units) and the range factor of the multiple scattering step limit can
+  * also be given.
   *
   * @param[in] g4NISTMatNames A vector of `Geant4` pre-defined NIST material names specifying the required materials.
   * @param[in] prodcut        The required secondary production threshold or cut value (in length [mm])
   * @param[in] verbose        Possibility of printing some infomation when the verbosity level is higher than zero.
+  * @param[in] mscRangeFactor The range factor of the multiple scattering step limit (smaller is more accurate but slower).
   */
-void FakeG4Setup(const std::vector<std::string>& g4NISTMatNames, double prodcut, int verbose=0);
+void FakeG4Setup(const std::vector<std::string>& g4NISTMatNames, double prodcut, int verbose=0, double mscRangeFactor=0.04);
 
 #endif // G4Setup_HH
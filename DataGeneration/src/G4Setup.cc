@@ -29,7 +29,7 @@
 #include "G4TransportationManager.hh"
 
 // builds a fake Geant4 geometry with all materials given just to be able to produce material-cuts couple
-void FakeG4Setup (const std::vector<std::string>& g4NISTMatNames, double prodcut, int verbose) {
+void FakeG4Setup (const std::vector<std::string>& g4NISTMatNames, double prodcut, int verbose, double mscRangeFactor) {
   if (g4NISTMatNames.size() < 1) return;
   //
   // --- Geometry definition: create the word and use the very first material to fill in
@@ -96,6 +96,6 @@ void FakeG4Setup (const std::vector<std::string>& g4NISTMatNames, double prodcut
   // --- Set MSC range factor 
   G4EmParameters *param = G4EmParameters::Instance();
   param->SetDefaults();
-  param->SetMscRangeFactor(0.04);
+  param->SetMscRangeFactor(mscRangeFactor);
 
 }
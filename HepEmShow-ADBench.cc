@@ -0,0 +1,277 @@
+/**
+ * @file    HepEmShow-ADBench.cc
+ *
+ * @brief The main funtion of the `HepEmShow-ADBench` AD overhead benchmark.
+ *
+ * The benchmark simulates the same configurations (primary particle, primary
+ * energies and number of layers) as the `HepEmShow` simulation application and
+ * measures the cost of the event processing in the mode of the given build:
+ * primal (no AD), forward-mode AD (`CODI_FORWARD`) or reverse-mode AD
+ * (`CODI_REVERSE`). Running the benchmark in all three builds with the same
+ * arguments gives the AD overhead.
+ *
+ * For each primary energy (1, 10 and 100 GeV by default) the following is
+ * reported:
+ * - events/s and steps/s of the event loop (after a few warm-up events that are
+ *   not measured)
+ * - in reverse-mode AD builds: the used tape memory per event and the time of
+ *   the reverse sweep (tape evaluation) per event
+ *
+ * The peak resident set size is reported once, for the whole process (i.e. for
+ * the largest of the energies). The results are written to the standard output and, in JSON format, to the
+ * `adbench_<mode>.json` file (or to the file given by `-o`).
+ *
+ * In forward-mode AD builds, the dot value of the primary energy is set to 1
+ * while in reverse-mode AD builds the bar values of all layers are set to 1
+ * (i.e. the derivatives of the total energy deposit are computed).
+ */
+
+// G4HepEm related includes
+#include "G4HepEmState.hh"
+#include "G4HepEmData.hh"
+#include "G4HepEmParameters.hh"
+#include "G4HepEmDataJsonIO.hh"
+#include "G4HepEmTLData.hh"
+#include "G4HepEmRandomEngine.hh"
+
+// Local includes:
+#include "URandom.hh"
+#include "Geometry.hh"
+#include "PrimaryGenerator.hh"
+#include "Results.hh"
+#include "EventLoop.hh"
+#include "ResourceUsage.hh"
+#include "PhysicsData.hh"
+#include "ToolSetup.hh"
+
+// System includes:
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+
+// NOTE: this is Unix specific!
+#include <getopt.h>
+
+
+/** Configuration of the benchmark (set by the input arguments).*/
+struct ADBenchParameters {
+  std::string         fParticleName    { "e-" };                          ///< primary particle name: {"e-", "e+" or "gamma"}
+  std::vector<double> fParticleEnergies{ 1000.0, 10000.0, 100000.0 };     ///< primary energies in [MeV]
+  int                 fNumLayers       { 50 };                            ///< number of layers in the calorimeter
+  int                 fNumEvents       { 100 };                           ///< number of measured events per energy
+  int                 fNumWarmUpEvents { 5 };                             ///< number of (not measured) warm-up events per energy
+  int                 fRandomSeed      { 1234 };                          ///< seed of the random number generator
+  std::string         fG4HepEmDataFile { "../data/hepem_data.json" };    ///< the pre-generated data file (with path)
+  std::string         fOutputFile      { "" };                            ///< the JSON output file (`adbench_<mode>.json` if empty)
+};
+
+/** Result of the benchmark for one configuration.*/
+struct ADBenchResult {
+  double fParticleEnergy    { 0.0 };  ///< primary energy in [MeV]
+  double fWallTime          { 0.0 };  ///< wall time of the event loop of the measured events in [s]
+  double fNumSteps          { 0.0 };  ///< mean number of steps per event
+  double fTapeBytesPerEvent { 0.0 };  ///< reverse-mode AD only: mean used tape memory per event in [byte]
+  double fReverseTime       { 0.0 };  ///< reverse-mode AD only: mean time of the reverse sweep per event in [s]
+};
+
+
+static struct option options[] = {
+  {"primary-particle      (possible particle names: e-, e+ and gamma)     - default: e-"               , required_argument, 0, 'p'},
+  {"primary-energies      (in [MeV] units, separated by :)                - default: 1000:10000:100000", required_argument, 0, 'e'},
+  {"number-of-layers      (number of layers in the calorimeter)           - default: 50"               , required_argument, 0, 'l'},
+  {"number-of-events      (number of measured events per energy)          - default: 100"              , required_argument, 0, 'n'},
+  {"number-of-warm-up     (number of warm-up events per energy)           - default: 5"                , required_argument, 0, 'w'},
+  {"random-seed                                                           - default: 1234"             , required_argument, 0, 's'},
+  {"g4hepem-data-file     (the pre-generated data file with its path)     - default: ../data/hepem_data", required_argument, 0, 'd'},
+  {"output-file           (the JSON output file)                          - default: adbench_<mode>.json", required_argument, 0, 'o'},
+  {"help"                                                                                              , no_argument      , 0, 'h'},
+  {0, 0, 0, 0}
+};
+
+static void Help() {
+  std::cout<<"\n === Usage: HepEmShow-ADBench [OPTIONS] \n"<<std::endl;
+  for (int i = 0; options[i].name != NULL; i++) {
+    printf("\t-%c  --%s\n", options[i].val, options[i].name);
+  }
+}
+
+static void GetOpt(int argc, char *argv[], ADBenchParameters& param) {
+  while (true) {
+    int c, optidx = 0;
+    c = getopt_long(argc, argv, "hp:e:l:n:w:s:d:o:", options, &optidx);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 'p':
+       param.fParticleName = optarg;
+       CheckParticleName(param.fParticleName, Help);
+       break;
+    case 'e': {
+       param.fParticleEnergies.clear();
+       std::string arg(optarg);
+       size_t pos = 0;
+       while (pos < arg.size()) {
+         size_t sep = arg.find(':', pos);
+         if (sep == std::string::npos) sep = arg.size();
+         param.fParticleEnergies.push_back(std::stod(arg.substr(pos, sep-pos)));
+         pos = sep+1;
+       }
+       break;
+    }
+    case 'l':
+       param.fNumLayers = std::stoi(optarg);
+       break;
+    case 'n':
+       param.fNumEvents = std::stoi(optarg);
+       break;
+    case 'w':
+       param.fNumWarmUpEvents = std::stoi(optarg);
+       break;
+    case 's':
+       param.fRandomSeed = std::stoi(optarg);
+       break;
+    case 'd':
+       param.fG4HepEmDataFile = G4HepEmDataFileName(optarg);
+       break;
+    case 'o':
+       param.fOutputFile = optarg;
+       break;
+    case 'h':
+    default:
+       Help();
+       exit(-1);
+    }
+  }
+  if (param.fNumLayers < 1 || param.fNumEvents < 1 || param.fNumWarmUpEvents < 0) {
+    printf("\n *** The number of layers and events must be >= 1 (warm-up events >= 0)! \n");
+    Help();
+    exit(-1);
+  }
+}
+
+
+/** Simulates the given number of events at the given primary energy, collects the results of the run and returns
+ *  the wall time of the event loop in [s] (without setting up the run).*/
+static double RunOne(G4HepEmState& theState, const ADBenchParameters& param, double energy, int numEvents, int seed, Results& theResult) {
+  URandom              theURnd(seed);
+  G4HepEmRandomEngine  theRandomEngine(&theURnd);
+  G4HepEmTLData        theTLData;
+  theTLData.SetRandomEngine(&theRandomEngine);
+  //
+  Geometry theGeometry;
+  theGeometry.SetNumLayers(param.fNumLayers);
+  //
+  G4double theEnergy = energy;
+  #ifdef CODI_FORWARD
+    SET_DOTVALUE(theEnergy, 1.0);
+  #endif
+  PrimaryGenerator thePrimaryGenerator;
+  SetUpPrimaryGenerator(thePrimaryGenerator, param.fParticleName, theEnergy, theGeometry);
+  //
+  InitResults(theResult, theGeometry.GetNumLayers());
+  #ifdef CODI_REVERSE
+    for (size_t i = 0; i < theResult.barEdep.size(); ++i) {
+      theResult.barEdep[i] = 1.0;
+    }
+  #endif
+  const double start = GetWallTime();
+  EventLoop::ProcessEvents(theTLData, theState, thePrimaryGenerator, theGeometry, theResult, numEvents, 0);
+  return GetWallTime() - start;
+}
+
+
+static void WriteJson(const std::string& fileName, const std::string& mode, const ADBenchParameters& param, const std::vector<ADBenchResult>& results, double peakRSS) {
+  std::ofstream os(fileName);
+  os << std::setprecision(10);
+  os << "{\n";
+  os << "  \"benchmark\": \"HepEmShow-ADBench\",\n";
+  os << "  \"mode\": \"" << mode << "\",\n";
+  os << "  \"particle\": \"" << param.fParticleName << "\",\n";
+  os << "  \"numLayers\": " << param.fNumLayers << ",\n";
+  os << "  \"numEvents\": " << param.fNumEvents << ",\n";
+  os << "  \"numWarmUpEvents\": " << param.fNumWarmUpEvents << ",\n";
+  os << "  \"peakRSS_MB\": " << peakRSS << ",\n";
+  os << "  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const ADBenchResult& r = results[i];
+    os << "    {\n";
+    os << "      \"energy_MeV\": " << r.fParticleEnergy << ",\n";
+    os << "      \"wallTime_s\": " << r.fWallTime << ",\n";
+    os << "      \"eventsPerSecond\": " << param.fNumEvents/r.fWallTime << ",\n";
+    os << "      \"stepsPerSecond\": " << r.fNumSteps*param.fNumEvents/r.fWallTime << ",\n";
+    os << "      \"stepsPerEvent\": " << r.fNumSteps << ",\n";
+    if (mode == "reverse") {
+      os << "      \"tapeBytesPerEvent\": " << r.fTapeBytesPerEvent << ",\n";
+      os << "      \"reverseTimePerEvent_s\": " << r.fReverseTime << "\n";
+    } else {
+      os << "      \"tapeBytesPerEvent\": null,\n";
+      os << "      \"reverseTimePerEvent_s\": null\n";
+    }
+    os << "    }" << (i+1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n";
+  os << "}\n";
+}
+
+
+int main(int argc, char* argv[]) {
+  ADBenchParameters param;
+  GetOpt(argc, argv, param);
+  #if defined(CODI_FORWARD)
+    const std::string mode = "forward";
+  #elif defined(CODI_REVERSE)
+    const std::string mode = "reverse";
+  #else
+    const std::string mode = "primal";
+  #endif
+  if (param.fOutputFile.empty()) {
+    param.fOutputFile = "adbench_" + mode + ".json";
+  }
+  //
+  G4HepEmState* theState = LoadG4HepEmState(param.fG4HepEmDataFile, Geometry().GetMaterialIndices());
+  if (theState == nullptr) {
+    return 1;
+  }
+  //
+  std::cout << " === HepEmShow-ADBench: mode = " << mode << ", " << param.fParticleName << " primaries, "
+            << param.fNumLayers << " layers, " << param.fNumEvents << " events per energy" << std::endl;
+  std::vector<ADBenchResult> results;
+  for (double energy : param.fParticleEnergies) {
+    // warm-up (not measured)
+    if (param.fNumWarmUpEvents > 0) {
+      Results theWarmUpResult;
+      RunOne(*theState, param, energy, param.fNumWarmUpEvents, param.fRandomSeed+1, theWarmUpResult);
+    }
+    Results theResult;
+    ADBenchResult res;
+    res.fParticleEnergy = energy;
+    res.fWallTime       = RunOne(*theState, param, energy, param.fNumEvents, param.fRandomSeed, theResult);
+    res.fNumSteps       = GET_VALUE(theResult.fNumStepsGamma + theResult.fNumStepsElPos)/param.fNumEvents;
+    #ifdef CODI_REVERSE
+      res.fTapeBytesPerEvent = theResult.fTapeBytesPerEvent.getMean();
+      res.fReverseTime       = theResult.fReverseTimePerEvent.getMean();
+    #endif
+    results.push_back(res);
+    //
+    std::cout << std::setprecision(6)
+              << "     - E = " << std::setw(8) << energy << " [MeV]: "
+              << std::setw(10) << param.fNumEvents/res.fWallTime << " events/s "
+              << std::setw(12) << res.fNumSteps*param.fNumEvents/res.fWallTime << " steps/s ";
+    if (mode == "reverse") {
+      std::cout << " tape = " << res.fTapeBytesPerEvent/(1024.0*1024.0) << " [MB/event]"
+                << " reverse = " << res.fReverseTime*1000.0 << " [ms/event]";
+    }
+    std::cout << std::endl;
+  }
+  // the peak resident set size of the whole process (i.e. of the largest of the energies)
+  const double thePeakRSS = GetPeakRSSMB();
+  std::cout << " === Peak RSS of the process = " << thePeakRSS << " [MB]" << std::endl;
+  WriteJson(param.fOutputFile, mode, param, results, thePeakRSS);
+  std::cout << " === Results written to " << param.fOutputFile << std::endl;
+  //
+  FreeG4HepEmData(theState->fData);
+  delete theState;
+  return 0;
+}
@@ -26,6 +26,27 @@
  * e.g. with a different material configuration if needed (see more in the
  * Geometry and Physics component documentations).
  *
+ * The secondary production threshold (`-c`), the multiple scattering range
+ * factor (`-f`), the list of materials (`-m`) and the output file (`-o`) are
+ * input arguments (with the values of the provided data file as defaults).
+ * Moreover, a family of named accuracy/speed presets (see `kPresets`) can be
+ * generated in one invocation (`-P fast:default:precise` or `-P all`): the
+ * data of the `default` preset is written into the `-o` file while that of
+ * any other preset `name` into `<-o file>_name`, which is the file that is
+ * selected at run time by the `-P name` input argument of `HepEmShow`.
+ *
+ * For scan campaigns, a manifest of configurations (`-M`) can be generated in
+ * one invocation: each line of the manifest gives one or more configurations
+ * with the `materials=A:B:C`, `cut=` and `msc=` keys (comma separated lists of
+ * cuts and range factors span a grid, the missing keys take the values of the
+ * input arguments). Each configuration is written into a content-hashed file
+ * `<-o file>_<hash>.json` (identical data give identical file names) and the
+ * configurations with their files are listed in `<-o file>_index`.
+ *
+ * As the `Geant4` state can be initialised only once per process, each data
+ * set (preset or configuration of the manifest) is generated in a separate
+ * child process, with at most `-j` of them running concurrently.
+ *
  * @note As the `G4HepEm` data generation requires its initialisation, that heavily
  * depends on `Geant4`, this `HepEmShow-DataGeneration` application requires a
  * complete, `Geant4` dependent build of `G4HepEm`. Moreover, as this data
@@ -59,21 +80,81 @@
 
 #include <vector>
 #include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
 
-int main () {
+// NOTE: this is Unix specific!
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
-  // secondary production threshold in length (change the value and regenerate the data)
-  const G4double secProdThreshold = 0.7 * mm;
 
-  // list of Geant4 (NIST) material names (change the listed material names and regenerate the data)
-  std::vector<std::string> matList {"G4_Galactic", "G4_PbWO4", "G4_lAr"};
+/** A named set of the accuracy related parameters of the data generation.*/
+struct DataPreset {
+  const char* fName;            ///< name of the preset (selected by `HepEmShow -P name`)
+  double      fSecProdThreshold;///< secondary production threshold in [mm]
+  double      fMscRangeFactor;  ///< range factor of the multiple scattering step limit
+};
+
+/** The accuracy/speed presets: the `default` corresponds to the provided data file.*/
+static const DataPreset kPresets[] = {
+  { "fast"   , 2.0, 0.08 },
+  { "default", 0.7, 0.04 },
+  { "precise", 0.1, 0.02 }
+};
+
+
+static struct option options[] = {
+  {"production-cut        (secondary production threshold in [mm])        - default: 0.7"    , required_argument, 0, 'c'},
+  {"msc-range-factor      (range factor of the MSC step limit)            - default: 0.04"   , required_argument, 0, 'f'},
+  {"materials             (NIST material names separated by :)            - default: G4_Galactic:G4_PbWO4:G4_lAr", required_argument, 0, 'm'},
+  {"output-file           (the G4HepEm data file with its path)           - default: ../data/hepem_data", required_argument, 0, 'o'},
+  {"presets               (presets to generate: names separated by : or all) - default: no presets", required_argument, 0, 'P'},
+  {"manifest              (file of the configurations to generate)        - default: no manifest", required_argument, 0, 'M'},
+  {"number-of-workers     (number of concurrent generator processes)      - default: 1"      , required_argument, 0, 'j'},
+  {"verbosity             (verbosity of the Geant4 setup)                 - default: 1"      , required_argument, 0, 'v'},
+  {"help"                                                                                    , no_argument      , 0, 'h'},
+  {0, 0, 0, 0}
+};
+
+static void Help() {
+  std::cout<<"\n === Usage: HepEmShow-DataGeneration [OPTIONS] \n"<<std::endl;
+  for (int i = 0; options[i].name != NULL; i++) {
+    printf("\t-%c  --%s\n", options[i].val, options[i].name);
+  }
+  std::cout<<"\n     presets (production cut [mm], MSC range factor):"<<std::endl;
+  for (const DataPreset& preset : kPresets) {
+    printf("\t%-8s (%g, %g)\n", preset.fName, preset.fSecProdThreshold, preset.fMscRangeFactor);
+  }
+}
+
+// splits the `:` separated list
+static std::vector<std::string> Split(const std::string& str) {
+  std::vector<std::string> items;
+  size_t pos = 0;
+  while (pos <= str.size()) {
+    size_t sep = str.find(':', pos);
+    if (sep == std::string::npos) sep = str.size();
+    if (sep > pos) items.push_back(str.substr(pos, sep-pos));
+    pos = sep+1;
+  }
+  return items;
+}
 
-  // output, i.e. the G4HepEm data, file name (change the file mane and regenerate the data)
-  const G4String fileName    = "../data/hepem_data";
+
+// generates the G4HepEm data for the given materials, cut and MSC range factor and writes it into the file
+static int GenerateData(const std::vector<std::string>& matList, G4double secProdThreshold, G4double mscRangeFactor, const G4String& fileName, int verbose) {
   const G4String g4hepemFile = fileName + ".json";
 
   // create a fake Geant4 geometry and init to have the material-cuts couples
-  FakeG4Setup (matList, secProdThreshold, 1);
+  FakeG4Setup (matList, secProdThreshold, verbose, mscRangeFactor);
 
   // construct the G4HepEmRunManager, which will fill the data structures
   // on calls to Initialize
@@ -102,3 +183,279 @@ int main () {
 
   return 0;
 }
+
+
+/** One data set to generate (a preset or a configuration of the manifest).*/
+struct DataJob {
+  std::vector<std::string> fMaterials;        ///< the Geant4 NIST material names
+  double                   fSecProdThreshold; ///< secondary production threshold in [mm]
+  double                   fMscRangeFactor;   ///< range factor of the multiple scattering step limit
+  std::string              fFileName;         ///< the output file (without extension): content-hashed if empty
+  pid_t                    fPid { -1 };       ///< the generator process
+};
+
+
+// 64-bit FNV-1a hash of the content of the file (as 16 hex digits)
+static std::string ContentHash(const std::string& fileName) {
+  std::ifstream is(fileName, std::ios::binary);
+  std::uint64_t hash = 14695981039346656037ULL;
+  char buffer[1 << 16];
+  while (is.read(buffer, sizeof(buffer)) || is.gcount() > 0) {
+    for (std::streamsize i = 0; i < is.gcount(); ++i) {
+      hash = (hash ^ static_cast<unsigned char>(buffer[i])) * 1099511628211ULL;
+    }
+  }
+  std::ostringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return ss.str();
+}
+
+
+// generates the data sets in child processes (at most `numWorkers` concurrently) into temporary files
+// that are renamed to their (content-hashed) output file when completed: returns the number of failures
+static int RunJobs(std::vector<DataJob>& jobs, int numWorkers, const std::string& fileName, int verbose) {
+  auto tmpName = [&](std::size_t ij) { return fileName + ".tmp" + std::to_string(ij); };
+  int numFailed  = 0;
+  int numRunning = 0;
+  std::size_t next = 0;
+  while (next < jobs.size() || numRunning > 0) {
+    // start new generator processes while there are free workers
+    while (next < jobs.size() && numRunning < numWorkers) {
+      std::cout.flush();
+      const pid_t pid = fork();
+      if (pid < 0) {
+        std::cerr << " *** Cannot fork the generator process of data set " << next << std::endl;
+        ++numFailed;
+        ++next;
+        continue;
+      }
+      if (pid == 0) {
+        // NOTE: `_exit` (no clean-up of the Geant4 state of the parent) so the output is flushed here
+        const DataJob& job = jobs[next];
+        const int status = GenerateData(job.fMaterials, job.fSecProdThreshold * mm, job.fMscRangeFactor, tmpName(next), verbose);
+        std::cout.flush();
+        std::fflush(nullptr);
+        _exit(status);
+      }
+      jobs[next++].fPid = pid;
+      ++numRunning;
+    }
+    // wait for any of them to complete
+    int status = 0;
+    const pid_t pid = wait(&status);
+    if (pid < 0) {
+      break;
+    }
+    --numRunning;
+    for (std::size_t ij = 0; ij < jobs.size(); ++ij) {
+      DataJob& job = jobs[ij];
+      if (job.fPid != pid) {
+        continue;
+      }
+      const std::string tmpFile = tmpName(ij) + ".json";
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << " *** Failed to generate the data set " << ij << std::endl;
+        std::remove(tmpFile.c_str());
+        job.fFileName.clear();
+        ++numFailed;
+        break;
+      }
+      if (job.fFileName.empty()) {
+        job.fFileName = fileName + "_" + ContentHash(tmpFile);
+      }
+      if (std::rename(tmpFile.c_str(), (job.fFileName + ".json").c_str()) != 0) {
+        std::cerr << " *** Cannot write the data set " << ij << " into " << job.fFileName << ".json" << std::endl;
+        job.fFileName.clear();
+        ++numFailed;
+        break;
+      }
+      std::cout << " === Data set " << ij << " (production cut = " << job.fSecProdThreshold << " [mm], MSC range factor = "
+                << job.fMscRangeFactor << ") written into " << job.fFileName << ".json" << std::endl;
+      break;
+    }
+  }
+  return numFailed;
+}
+
+
+// reads the manifest: the configurations of each line (grid of the cut and msc lists)
+static bool ReadManifest(const std::string& manifestFile, const DataJob& defaults, std::vector<DataJob>& jobs) {
+  std::ifstream is(manifestFile);
+  if (!is) {
+    std::cerr << " *** Cannot open the manifest " << manifestFile << std::endl;
+    return false;
+  }
+  auto splitList = [](const std::string& str) {
+    std::vector<double> values;
+    std::istringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      values.push_back(std::stod(item));
+    }
+    return values;
+  };
+  std::string line;
+  int lineNum = 0;
+  while (std::getline(is, line)) {
+    ++lineNum;
+    line = line.substr(0, line.find('#'));
+    std::istringstream ls(line);
+    std::vector<std::string> materials = defaults.fMaterials;
+    std::vector<double> cuts = { defaults.fSecProdThreshold };
+    std::vector<double> mscs = { defaults.fMscRangeFactor };
+    std::string token;
+    bool any = false;
+    try {
+      while (ls >> token) {
+        const size_t pos = token.find('=');
+        const std::string key = token.substr(0, pos);
+        const std::string val = pos == std::string::npos ? "" : token.substr(pos+1);
+        if (key == "materials" && pos != std::string::npos) {
+          materials = Split(val);
+        } else if (key == "cut" && pos != std::string::npos) {
+          cuts = splitList(val);
+        } else if (key == "msc" && pos != std::string::npos) {
+          mscs = splitList(val);
+        } else {
+          throw std::invalid_argument("unknown key " + token);
+        }
+        any = true;
+      }
+      if (!any) {
+        continue;
+      }
+      for (double cut : cuts) {
+        for (double msc : mscs) {
+          if (materials.empty() || !(cut > 0.0) || !(msc > 0.0)) {
+            throw std::invalid_argument("invalid value");
+          }
+          DataJob job;
+          job.fMaterials        = materials;
+          job.fSecProdThreshold = cut;
+          job.fMscRangeFactor   = msc;
+          jobs.push_back(job);
+        }
+      }
+    } catch (const std::exception& e) {
+      std::cerr << " *** Invalid line " << lineNum << " of the manifest " << manifestFile << ": " << e.what() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+int main (int argc, char *argv[]) {
+
+  // secondary production threshold in length (the value of the provided data file)
+  G4double secProdThreshold = 0.7 * mm;
+
+  // range factor of the multiple scattering step limit
+  G4double mscRangeFactor   = 0.04;
+
+  // list of Geant4 (NIST) material names (the order gives the material-cuts indices used by the `Geometry`)
+  std::vector<std::string> matList {"G4_Galactic", "G4_PbWO4", "G4_lAr"};
+
+  // output, i.e. the G4HepEm data, file name
+  G4String fileName = "../data/hepem_data";
+
+  // the presets to generate (if any)
+  std::vector<const DataPreset*> presets;
+
+  // the manifest of the configurations to generate (if any)
+  std::string manifestFile;
+
+  int verbose    = 1;
+  int numWorkers = 1;
+  while (true) {
+    int c, optidx = 0;
+    c = getopt_long(argc, argv, "hc:f:m:o:P:M:j:v:", options, &optidx);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 'c': secProdThreshold = std::stod(optarg) * mm; break;
+    case 'f': mscRangeFactor   = std::stod(optarg); break;
+    case 'm': matList          = Split(optarg); break;
+    case 'o': fileName         = optarg; break;
+    case 'M': manifestFile     = optarg; break;
+    case 'j': numWorkers       = std::stoi(optarg); break;
+    case 'v': verbose          = std::stoi(optarg); break;
+    case 'P': {
+       presets.clear();
+       for (const std::string& name : Split(optarg)) {
+         bool found = false;
+         for (const DataPreset& preset : kPresets) {
+           if (name == "all" || name == preset.fName) {
+             presets.push_back(&preset);
+             found = true;
+           }
+         }
+         if (!found) {
+           std::cerr << "\n *** Unknown preset -P: " << name << std::endl;
+           Help();
+           return 1;
+         }
+       }
+       break;
+    }
+    case 'h':
+    default:
+       Help();
+       return 1;
+    }
+  }
+  if (matList.empty() || !(secProdThreshold > 0.0) || !(mscRangeFactor > 0.0) || numWorkers < 1) {
+    std::cerr << "\n *** The list of materials (-m) must not be empty, the production cut (-c) and MSC range factor (-f) must be > 0"
+              << " and the number of workers (-j) >= 1!" << std::endl;
+    Help();
+    return 1;
+  }
+
+  if (presets.empty() && manifestFile.empty()) {
+    return GenerateData(matList, secProdThreshold, mscRangeFactor, fileName, verbose);
+  }
+
+  // the data sets: the presets (with their names) and the configurations of the manifest (content-hashed)
+  std::vector<DataJob> jobs;
+  for (const DataPreset* preset : presets) {
+    DataJob job;
+    job.fMaterials        = matList;
+    job.fSecProdThreshold = preset->fSecProdThreshold;
+    job.fMscRangeFactor   = preset->fMscRangeFactor;
+    job.fFileName         = std::string(preset->fName) == "default" ? fileName : fileName + "_" + preset->fName;
+    jobs.push_back(job);
+  }
+  const std::size_t numPresets = jobs.size();
+  if (!manifestFile.empty()) {
+    DataJob defaults;
+    defaults.fMaterials        = matList;
+    defaults.fSecProdThreshold = secProdThreshold / mm;
+    defaults.fMscRangeFactor   = mscRangeFactor;
+    if (!ReadManifest(manifestFile, defaults, jobs)) {
+      return 1;
+    }
+  }
+  std::cout << " === Generating " << jobs.size() << " data sets with " << numWorkers << " worker processes" << std::endl;
+  const int numFailed = RunJobs(jobs, numWorkers, fileName, verbose);
+
+  // the index of the configurations of the manifest and their content-hashed files
+  if (!manifestFile.empty()) {
+    const std::string indexFile = fileName + "_index";
+    std::ofstream index(indexFile);
+    index << "# file production-cut[mm] msc-range-factor materials" << std::endl;
+    for (std::size_t ij = numPresets; ij < jobs.size(); ++ij) {
+      const DataJob& job = jobs[ij];
+      if (job.fFileName.empty()) {
+        continue;
+      }
+      index << job.fFileName << ".json " << job.fSecProdThreshold << " " << job.fMscRangeFactor << " ";
+      for (std::size_t im = 0; im < job.fMaterials.size(); ++im) {
+        index << (im > 0 ? ":" : "") << job.fMaterials[im];
+      }
+      index << std::endl;
+    }
+    std::cout << " === The configurations and their data files are listed in " << indexFile << std::endl;
+  }
+
+  return numFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file    HepEmShow-bench.cc
+ *
+ * @brief The main funtion of the `HepEmShow-bench` microbenchmarks.
+ *
+ * Microbenchmarks of the hot kernels of the simulation, measured in isolation
+ * (i.e. without the `G4HepEm` physics), to evaluate any change of these kernels:
+ * - `Box::DistanceToOut` (both the direction and the safety overloads) for
+ *   points inside a box and isotropic directions
+ * - `Geometry::CalculateDistanceToOut` for points distributed uniformly in the
+ *   calorimeter (and some before it) and directions that are either isotropic
+ *   or forward peaked as in the shower
+ * - `TrackStack` cycles of `Insert` + `Copy` of a few tracks followed by
+ *   `PopInto` all of them
+ * - `Hist::Fill` (with weight) over the 50 layers
+ * - `URandom::flat`
+ * - `Accumulator::add` (with and without outlier exclusion)
+ * - `SteppingLoop::StackSecondaries` of 2 \f$e^-\f$ and 1 \f$\gamma\f$ secondaries
+ *
+ * Each kernel is executed `-n` times per repetition, after `-w` warm-up
+ * repetitions (not measured) in `-r` measured repetitions. The mean, the standard
+ * deviation, the minimum and the maximum time per operation over the measured
+ * repetitions are reported. A subset of the benchmarks can be selected by `-f`
+ * (the benchmarks with names that contain the given string are executed).
+ */
+
+// G4HepEm related includes
+#include "G4HepEmTLData.hh"
+#include "G4HepEmTrack.hh"
+#include "G4HepEmRandomEngine.hh"
+
+// Local includes:
+#include "URandom.hh"
+#include "Box.hh"
+#include "Geometry.hh"
+#include "TrackStack.hh"
+#include "Hist.hh"
+#include "SteppingLoop.hh"
+#include "accumulator.hh"
+
+// System includes:
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+
+// NOTE: this is Unix specific!
+#include <getopt.h>
+
+
+/** Configuration of the microbenchmarks (set by the input arguments).*/
+struct BenchParameters {
+  int         fNumOperations  { 100000 };  ///< number of operations (kernel calls) per repetition
+  int         fNumRepetitions { 20 };      ///< number of measured repetitions
+  int         fNumWarmUp      { 3 };       ///< number of (not measured) warm-up repetitions
+  std::string fFilter         { "" };      ///< only the benchmarks with name containing this string are executed
+};
+
+/** The results of the kernels are summed up here to keep the compiler from removing the kernel calls.*/
+static volatile double gSink = 0.0;
+
+
+static struct option options[] = {
+  {"number-of-operations  (number of kernel calls per repetition)         - default: 100000", required_argument, 0, 'n'},
+  {"number-of-repetitions (number of measured repetitions)                - default: 20"    , required_argument, 0, 'r'},
+  {"number-of-warm-up     (number of not measured warm-up repetitions)    - default: 3"     , required_argument, 0, 'w'},
+  {"filter                (run benchmarks with name containing this)     - default: all"   , required_argument, 0, 'f'},
+  {"help"                                                                                   , no_argument      , 0, 'h'},
+  {0, 0, 0, 0}
+};
+
+static void Help() {
+  std::cout<<"\n === Usage: HepEmShow-bench [OPTIONS] \n"<<std::endl;
+  for (int i = 0; options[i].name != NULL; i++) {
+    printf("\t-%c  --%s\n", options[i].val, options[i].name);
+  }
+}
+
+static void GetOpt(int argc, char *argv[], BenchParameters& param) {
+  while (true) {
+    int c, optidx = 0;
+    c = getopt_long(argc, argv, "hn:r:w:f:", options, &optidx);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 'n':
+       param.fNumOperations = std::stoi(optarg);
+       break;
+    case 'r':
+       param.fNumRepetitions = std::stoi(optarg);
+       break;
+    case 'w':
+       param.fNumWarmUp = std::stoi(optarg);
+       break;
+    case 'f':
+       param.fFilter = optarg;
+       break;
+    case 'h':
+    default:
+       Help();
+       exit(-1);
+    }
+  }
+  if (param.fNumOperations < 1 || param.fNumRepetitions < 2 || param.fNumWarmUp < 0) {
+    printf("\n *** The number of operations must be >= 1, repetitions >= 2 (warm-up >= 0)! \n");
+    Help();
+    exit(-1);
+  }
+}
+
+
+/** Executes the `kernel(i)` for `i = 0,...,N-1` operations in the warm-up and measured repetitions and reports the time per operation.*/
+template <typename Kernel>
+static void RunBenchmark(const std::string& name, const BenchParameters& param, Kernel kernel) {
+  if (name.find(param.fFilter) == std::string::npos) {
+    return;
+  }
+  for (int ir = 0; ir < param.fNumWarmUp; ++ir) {
+    for (int i = 0; i < param.fNumOperations; ++i) {
+      kernel(i);
+    }
+  }
+  Accumulator<double> timePerOp;
+  double minTime = 1.0E+20;
+  double maxTime = 0.0;
+  for (int ir = 0; ir < param.fNumRepetitions; ++ir) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < param.fNumOperations; ++i) {
+      kernel(i);
+    }
+    auto stop = std::chrono::steady_clock::now();
+    const double t = std::chrono::duration<double, std::nano>(stop - start).count()/param.fNumOperations;
+    timePerOp.add(t);
+    minTime = std::min(minTime, t);
+    maxTime = std::max(maxTime, t);
+  }
+  const double stdDev = std::sqrt(std::max(0.0, timePerOp.getVar()));
+  std::cout << std::setprecision(4) << std::fixed
+            << "  " << std::left << std::setw(44) << name << std::right
+            << std::setw(10) << timePerOp.getMean() << " +- " << std::setw(8) << stdDev
+            << "  [min " << std::setw(10) << minTime << ", max " << std::setw(10) << maxTime << "] ns/op"
+            << std::endl;
+}
+
+
+/** Isotropic direction sampled by using the given random number generator.*/
+static void SampleIsotropic(URandom& rnd, G4double* v) {
+  const double cost = 1.0 - 2.0*GET_VALUE(rnd.flat());
+  const double sint = std::sqrt((1.0 - cost)*(1.0 + cost));
+  const double phi  = 2.0*M_PI*GET_VALUE(rnd.flat());
+  v[0] = cost;
+  v[1] = sint*std::cos(phi);
+  v[2] = sint*std::sin(phi);
+}
+
+/** Forward (+x) peaked direction, as the most of the tracks in the shower, sampled by using the given random number generator.*/
+static void SampleForward(URandom& rnd, G4double* v) {
+  const double u    = GET_VALUE(rnd.flat());
+  const double cost = 1.0 - 2.0*u*u*u*u;
+  const double sint = std::sqrt((1.0 - cost)*(1.0 + cost));
+  const double phi  = 2.0*M_PI*GET_VALUE(rnd.flat());
+  v[0] = cost;
+  v[1] = sint*std::cos(phi);
+  v[2] = sint*std::sin(phi);
+}
+
+
+int main(int argc, char* argv[]) {
+  BenchParameters param;
+  GetOpt(argc, argv, param);
+  //
+  // the input points/directions are pre-generated (a number that fits into the caches)
+  const int kNumSamples = 4096;
+  URandom theURnd(1234);
+  std::cout << " === HepEmShow-bench: " << param.fNumOperations << " operations x "
+            << param.fNumRepetitions << " repetitions (after " << param.fNumWarmUp
+            << " warm-up repetitions) \n"
+            << "  " << std::left << std::setw(44) << "benchmark" << std::right
+            << "   mean +- std. dev. time per operation " << std::endl;
+  //
+  // Box::DistanceToOut: points inside a box with isotropic directions
+  {
+    Box theBox("Bench", 0, 1.15, 200.0, 200.0);
+    std::vector<G4double> pos(3*kNumSamples), dir(3*kNumSamples);
+    for (int i = 0; i < kNumSamples; ++i) {
+      pos[3*i+0] = (2.0*GET_VALUE(theURnd.flat()) - 1.0)*1.15;
+      pos[3*i+1] = (2.0*GET_VALUE(theURnd.flat()) - 1.0)*200.0;
+      pos[3*i+2] = (2.0*GET_VALUE(theURnd.flat()) - 1.0)*200.0;
+      SampleIsotropic(theURnd, &dir[3*i]);
+    }
+    RunBenchmark("Box::DistanceToOut(r,v)", param, [&](int i) {
+      const int is = i & (kNumSamples-1);
+      gSink = gSink + GET_VALUE(theBox.DistanceToOut(&pos[3*is], &dir[3*is]));
+    });
+    RunBenchmark("Box::DistanceToOut(r)", param, [&](int i) {
+      const int is = i & (kNumSamples-1);
+      gSink = gSink + GET_VALUE(theBox.DistanceToOut(&pos[3*is]));
+    });
+  }
+  //
+  // Geometry::CalculateDistanceToOut: points in the calorimeter (10% before it)
+  // with isotropic or forward peaked directions
+  {
+    Geometry theGeometry;
+    const double xmin = GET_VALUE(theGeometry.GetPrimaryXposition());
+    const double x0   = GET_VALUE(theGeometry.GetCaloStartXposition());
+    const double dx   = GET_VALUE(theGeometry.GetCaloThick());
+    const double yz   = 0.5*GET_VALUE(theGeometry.GetCaloSizeYZ());
+    std::vector<G4double> pos(3*kNumSamples), dirIso(3*kNumSamples), dirFwd(3*kNumSamples);
+    for (int i = 0; i < kNumSamples; ++i) {
+      pos[3*i+0] = GET_VALUE(theURnd.flat()) < 0.1 ? xmin + (x0-xmin)*GET_VALUE(theURnd.flat()) : x0 + dx*GET_VALUE(theURnd.flat());
+      pos[3*i+1] = 0.2*yz*(2.0*GET_VALUE(theURnd.flat()) - 1.0);
+      pos[3*i+2] = 0.2*yz*(2.0*GET_VALUE(theURnd.flat()) - 1.0);
+      SampleIsotropic(theURnd, &dirIso[3*i]);
+      SampleForward(theURnd, &dirFwd[3*i]);
+    }
+    Box* theVolume = nullptr;
+    int  indxLayer = -1;
+    int  indxAbs   = -1;
+    G4double r[3];
+    RunBenchmark("Geometry::CalculateDistanceToOut(isotropic)", param, [&](int i) {
+      const int is = i & (kNumSamples-1);
+      r[0] = pos[3*is]; r[1] = pos[3*is+1]; r[2] = pos[3*is+2];
+      gSink = gSink + GET_VALUE(theGeometry.CalculateDistanceToOut(r, &dirIso[3*is], &theVolume, &indxLayer, &indxAbs));
+    });
+    RunBenchmark("Geometry::CalculateDistanceToOut(forward)", param, [&](int i) {
+      const int is = i & (kNumSamples-1);
+      r[0] = pos[3*is]; r[1] = pos[3*is+1]; r[2] = pos[3*is+2];
+      gSink = gSink + GET_VALUE(theGeometry.CalculateDistanceToOut(r, &dirFwd[3*is], &theVolume, &indxLayer, &indxAbs));
+    });
+  }
+  //
+  // TrackStack: Insert+Copy 4 tracks then PopInto all of them
+  {
+    TrackStack   theTrackStack;
+    G4HepEmTrack theTrack;
+    theTrack.SetEKin(10.0);
+    G4HepEmTrack thePopped;
+    RunBenchmark("TrackStack::Insert+Copy+PopInto(x4)", param, [&](int i) {
+      for (int it = 0; it < 4; ++it) {
+        theTrack.SetID(i+it);
+        theTrackStack.Copy(theTrack, theTrackStack.Insert());
+      }
+      while (theTrackStack.PopInto(thePopped) > -1) {
+        gSink = gSink + thePopped.GetID();
+      }
+    });
+  }
+  //
+  // Hist::Fill: weighted fill over the 50 layers
+  {
+    Hist theHist("bench-hist", 0.0, 50.0, 50);
+    std::vector<double> xs(kNumSamples);
+    for (int i = 0; i < kNumSamples; ++i) {
+      xs[i] = 50.0*GET_VALUE(theURnd.flat());
+    }
+    RunBenchmark("Hist::Fill(x,w)", param, [&](int i) {
+      theHist.Fill(xs[i & (kNumSamples-1)], 1.0);
+    });
+    gSink = gSink + GET_VALUE(theHist.GetSum());
+  }
+  //
+  // URandom::flat
+  {
+    URandom theRnd(4321);
+    RunBenchmark("URandom::flat", param, [&](int) {
+      gSink = gSink + GET_VALUE(theRnd.flat());
+    });
+  }
+  //
+  // Accumulator::add: without and with (2 lowest, 2 largest) outlier exclusion
+  {
+    Accumulator<double> theAcc;
+    Accumulator<double> theAccOutliers(2);
+    RunBenchmark("Accumulator::add", param, [&](int i) {
+      theAcc.add(0.5*i);
+    });
+    RunBenchmark("Accumulator::add(outliers)", param, [&](int i) {
+      theAccOutliers.add(0.5*i);
+    });
+    gSink = gSink + theAcc.getMean() + theAccOutliers.getMean();
+  }
+  //
+  // SteppingLoop::StackSecondaries: 2 e- and 1 gamma secondaries (then popped)
+  {
+    URandom             theRnd(4321);
+    G4HepEmRandomEngine theRandomEngine(&theRnd);
+    G4HepEmTLData       theTLData;
+    theTLData.SetRandomEngine(&theRandomEngine);
+    TrackStack   theTrackStack;
+    G4HepEmTrack thePrimary;
+    thePrimary.SetEKin(100.0);
+    thePrimary.SetID(0);
+    G4HepEmTrack thePopped;
+    RunBenchmark("SteppingLoop::StackSecondaries(2e-,1g)", param, [&](int) {
+      theTLData.AddSecondaryElectronTrack()->GetTrack()->SetEKin(1.0);
+      theTLData.AddSecondaryElectronTrack()->GetTrack()->SetEKin(2.0);
+      theTLData.AddSecondaryGammaTrack()->GetTrack()->SetEKin(3.0);
+      SteppingLoop::StackSecondaries(theTLData, theTrackStack, thePrimary);
+      while (theTrackStack.PopInto(thePopped) > -1) {
+        gSink = gSink + thePopped.GetID();
+      }
+      theTrackStack.ReSetTrackID();
+    });
+  }
+  //
+  std::cout << std::scientific << " === (checksum: " << gSink << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,212 @@
+/**
+ * @file    HepEmShow-mlmc.cc
+ *
+ * @brief The main funtion of the `HepEmShow-mlmc` multilevel Monte Carlo estimator over production-cut fidelity levels.
+ *
+ * The levels are given by `G4HepEm` data files (`-d`, coarsest first) generated
+ * by `HepEmShow-DataGeneration` for the same materials with decreasing secondary
+ * production thresholds (e.g. 2, 1 and 0.7 mm): the higher the fidelity, the
+ * more secondaries and the more expensive the events. The mean energy deposit
+ * per layer of the finest level is estimated by the multilevel Monte Carlo
+ * estimator (see `MultiLevelMC`) from many cheap events of the coarsest level
+ * and a few coupled events of the finer levels (each simulated with the data
+ * of the level and of the previous one from the same seed, see
+ * `EventLoop::ProcessEventsCoupled()`):
+ * - first, `-n` pilot events are simulated on each level to estimate the
+ *   variance and the cost per event of the levels
+ * - then the optimal number of events of each level is computed for the target
+ *   relative standard error (`-E`) of the estimates and the missing events are
+ *   simulated (at most `-N` per level), which is repeated once more with the
+ *   updated variances and costs
+ *
+ * The estimates of the mean energy deposit per layer and their standard errors
+ * are written into the `-o` file (`mlmc_edeps` by default), while the number of
+ * events, variance and cost of the levels and the estimated cost saving
+ * compared to events of the finest level only are printed.
+ *
+ * @note All data files must be generated for the same list of materials (the
+ * `G4HepEm` material-cuts indices of the `Geometry`). The derivatives are not
+ * computed (the events are primal runs) so the outputs are the same in all builds.
+ */
+
+// G4HepEm related includes
+#include "G4HepEmState.hh"
+#include "G4HepEmData.hh"
+#include "G4HepEmParameters.hh"
+#include "G4HepEmDataJsonIO.hh"
+#include "G4HepEmTLData.hh"
+#include "G4HepEmRandomEngine.hh"
+
+// Local includes:
+#include "URandom.hh"
+#include "Geometry.hh"
+#include "PrimaryGenerator.hh"
+#include "Results.hh"
+#include "EventLoop.hh"
+#include "MultiLevelMC.hh"
+#include "PhysicsData.hh"
+#include "ToolSetup.hh"
+
+// System includes:
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <algorithm>
+
+// NOTE: this is Unix specific!
+#include <getopt.h>
+
+
+/** Configuration of the estimator (set by the input arguments).*/
+struct MLMCParameters {
+  std::vector<std::string> fG4HepEmDataFiles;                 ///< the data files of the levels (coarsest first, with path)
+  std::string fParticleName      { "e-" };                    ///< primary particle name: {"e-", "e+" or "gamma"}
+  double      fParticleEnergy    { 10000.0 };                 ///< primary energy in [MeV]
+  double      fThicknessAbsorber { 2.3 };                     ///< thickness of the absorber in [mm]
+  double      fThicknessGap      { 5.7 };                     ///< thickness of the gap in [mm]
+  int         fNumLayers         { 50 };                      ///< number of layers in the calorimeter
+  int         fNumPilotEvents    { 100 };                     ///< number of pilot events per level
+  int         fMaxNumEvents      { 1000000 };                 ///< maximum number of events per level
+  double      fTargetRelError    { 0.01 };                    ///< target relative standard error of the estimates
+  int         fRandomSeed        { 1234 };                    ///< seed of the run (the seeds of the levels are derived from it)
+  std::string fOutputFile        { "mlmc_edeps" };            ///< the file of the estimates
+};
+
+
+static struct option options[] = {
+  {"g4hepem-data-files    (data files of the levels, coarsest first, separated by :) - required", required_argument, 0, 'd'},
+  {"primary-particle      (possible particle names: e-, e+ and gamma)     - default: e-"        , required_argument, 0, 'p'},
+  {"primary-energy        (in internal [MeV] units)                       - default: 10000"     , required_argument, 0, 'e'},
+  {"absorber-thickness    (in internal [mm] units)                        - default: 2.3"       , required_argument, 0, 'a'},
+  {"gap-thickness         (in internal [mm] units)                        - default: 5.7"       , required_argument, 0, 'g'},
+  {"number-of-layers      (number of layers in the calorimeter)           - default: 50"        , required_argument, 0, 'l'},
+  {"number-of-pilot-events(number of pilot events per level)              - default: 100"       , required_argument, 0, 'n'},
+  {"max-number-of-events  (maximum number of events per level)            - default: 1000000"   , required_argument, 0, 'N'},
+  {"target-precision      (relative standard error of the estimates)      - default: 0.01"      , required_argument, 0, 'E'},
+  {"random-seed                                                           - default: 1234"      , required_argument, 0, 's'},
+  {"output-file           (the file of the estimates)                     - default: mlmc_edeps", required_argument, 0, 'o'},
+  {"help"                                                                                       , no_argument      , 0, 'h'},
+  {0, 0, 0, 0}
+};
+
+static void Help() {
+  std::cout<<"\n === Usage: HepEmShow-mlmc [OPTIONS] \n"<<std::endl;
+  for (int i = 0; options[i].name != NULL; i++) {
+    printf("\t-%c  --%s\n", options[i].val, options[i].name);
+  }
+}
+
+static void GetOpt(int argc, char *argv[], MLMCParameters& param) {
+  while (true) {
+    int c, optidx = 0;
+    c = getopt_long(argc, argv, "hd:p:e:a:g:l:n:N:E:s:o:", options, &optidx);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 'd': {
+       param.fG4HepEmDataFiles.clear();
+       std::string arg(optarg);
+       size_t pos = 0;
+       while (pos < arg.size()) {
+         size_t sep = arg.find(':', pos);
+         if (sep == std::string::npos) sep = arg.size();
+         param.fG4HepEmDataFiles.push_back(G4HepEmDataFileName(arg.substr(pos, sep-pos)));
+         pos = sep+1;
+       }
+       break;
+    }
+    case 'p':
+       param.fParticleName = optarg;
+       CheckParticleName(param.fParticleName, Help);
+       break;
+    case 'e': param.fParticleEnergy    = std::stod(optarg); break;
+    case 'a': param.fThicknessAbsorber = std::stod(optarg); break;
+    case 'g': param.fThicknessGap      = std::stod(optarg); break;
+    case 'l': param.fNumLayers         = std::stoi(optarg); break;
+    case 'n': param.fNumPilotEvents    = std::stoi(optarg); break;
+    case 'N': param.fMaxNumEvents      = std::stoi(optarg); break;
+    case 'E': param.fTargetRelError    = std::stod(optarg); break;
+    case 's': param.fRandomSeed        = std::stoi(optarg); break;
+    case 'o': param.fOutputFile        = optarg; break;
+    case 'h':
+    default:
+       Help();
+       exit(-1);
+    }
+  }
+  if (param.fG4HepEmDataFiles.empty()) {
+    printf("\n *** The data files of the levels (-d) are required! \n");
+    Help();
+    exit(-1);
+  }
+  if (param.fNumLayers < 1 || param.fNumPilotEvents < 2 || param.fMaxNumEvents < param.fNumPilotEvents || !(param.fTargetRelError > 0.0)) {
+    printf("\n *** The number of layers (-l) must be >= 1, of the pilot events (-n) >= 2 and <= the maximum (-N), and the target precision (-E) > 0! \n");
+    Help();
+    exit(-1);
+  }
+}
+
+
+int main(int argc, char* argv[]) {
+  MLMCParameters param;
+  GetOpt(argc, argv, param);
+  //
+  URandom              theURnd(param.fRandomSeed);
+  G4HepEmRandomEngine  theRandomEngine(&theURnd);
+  G4HepEmTLData        theTLData;
+  theTLData.SetRandomEngine(&theRandomEngine);
+  Geometry theGeometry;
+  SetUpGeometry(theGeometry, param.fNumLayers, param.fThicknessAbsorber, param.fThicknessGap);
+  //
+  // the G4HepEm data of all levels are loaded once (all must provide the material-cuts couples of the geometry)
+  const int numLevels = param.fG4HepEmDataFiles.size();
+  std::vector<G4HepEmState*> theStates;
+  for (const std::string& file : param.fG4HepEmDataFiles) {
+    G4HepEmState* theState = LoadG4HepEmState(file, theGeometry.GetMaterialIndices());
+    if (theState == nullptr) {
+      return 1;
+    }
+    theStates.push_back(theState);
+  }
+  PrimaryGenerator thePrimaryGenerator;
+  SetUpPrimaryGenerator(thePrimaryGenerator, param.fParticleName, param.fParticleEnergy, theGeometry);
+  Results theFineResult, theCoarseResult;
+  InitResults(theFineResult, theGeometry.GetNumLayers());
+  InitResults(theCoarseResult, theGeometry.GetNumLayers());
+  theFineResult.fComputeDerivatives   = false;
+  theCoarseResult.fComputeDerivatives = false;
+  //
+  MultiLevelMC theMLMC(numLevels, theGeometry.GetNumLayers());
+  auto simulate = [&](int level, int numEvents) {
+    const std::uint64_t levelSeed = URandom::EventSeed(param.fRandomSeed, level);
+    EventLoop::ProcessEventsCoupled(theTLData, theURnd, *theStates[level], level > 0 ? theStates[level-1] : nullptr, thePrimaryGenerator, theGeometry,
+                                    theFineResult, theCoarseResult, theMLMC, level, theMLMC.GetNumEvents(level), numEvents, levelSeed);
+  };
+  std::cout << " === HepEmShow-mlmc: " << numLevels << " levels, " << param.fNumPilotEvents << " pilot events per level" << std::endl;
+  for (int l = 0; l < numLevels; ++l) {
+    simulate(l, param.fNumPilotEvents);
+  }
+  // the optimal number of events of the levels (updated once with the variances and costs of the simulated events)
+  double targetVariance = 0.0;
+  for (int round = 0; round < 2; ++round) {
+    targetVariance = theMLMC.TargetVariance(param.fTargetRelError);
+    const std::vector<int> numEvents = theMLMC.OptimalNumEvents(targetVariance);
+    for (int l = 0; l < numLevels; ++l) {
+      const int numMissing = std::min(numEvents[l], param.fMaxNumEvents) - theMLMC.GetNumEvents(l);
+      if (numMissing > 0) {
+        std::cout << "     - level " << l << ": " << numMissing << " more events" << std::endl;
+        simulate(l, numMissing);
+      }
+    }
+  }
+  theMLMC.Write(param.fOutputFile, std::cout, targetVariance);
+  //
+  for (G4HepEmState* theState : theStates) {
+    FreeG4HepEmData(theState->fData);
+    delete theState;
+  }
+  return 0;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file    HepEmShow-optimize.cc
+ *
+ * @brief The main funtion of the `HepEmShow-optimize` gradient-based design optimizer (reverse-mode AD builds).
+ *
+ * Optimizes the absorber and/or gap thicknesses of the calorimeter by stochastic
+ * gradient descent (`sgd`) or by `adam` inside one process: the `G4HepEm` data
+ * are loaded, and the `G4HepEmTLData`, random engine, `Geometry` and
+ * `PrimaryGenerator` are constructed only once, and the tape of the reverse-mode
+ * AD type is reused by all iterations (i.e. its memory is kept).
+ *
+ * The objective is the linear functional \f$ J = \sum_i b_i \langle E_i \rangle \f$
+ * of the mean energy deposit \f$ \langle E_i \rangle \f$ per layer with the
+ * weights \f$ b_i \f$ given by `-b` (the bar values of the edeps as in `HepEmShow`).
+ * In each iteration, a batch of `-n` events is simulated with the current
+ * thicknesses (started from the `-s` seed plus the iteration index) and the
+ * means of the `barThicknessAbsorber` and `barThicknessGap` accumulators, i.e.
+ * the stochastic gradient of \f$ J \f$, are used to update the thicknesses:
+ * - `sgd`: \f$ p \leftarrow p \mp \eta g \f$
+ * - `adam`: \f$ p \leftarrow p \mp \eta \hat{m}/(\sqrt{\hat{v}}+\epsilon) \f$ with the bias
+ *   corrected moving averages \f$ \hat{m}, \hat{v} \f$ of the gradient and its square
+ *   (\f$ \beta_1 = 0.9 \f$, \f$ \beta_2 = 0.999 \f$, \f$ \epsilon = 10^{-8} \f$), i.e. the
+ *   step is about \f$ \eta \f$ [mm] independently of the scale of \f$ J \f$
+ *
+ * The objective is minimised (maximised with `-x`) and the thicknesses are kept
+ * above the `-m` minimum. The iteration index, the thicknesses, the objective
+ * and the gradient (with its standard error) of each iteration are written
+ * into the trajectory file (`-t`) and to the standard output.
+ *
+ * @note The derivatives are only available in reverse-mode AD builds: the
+ * optimizer stops with an error in other builds.
+ */
+
+// G4HepEm related includes
+#include "G4HepEmState.hh"
+#include "G4HepEmData.hh"
+#include "G4HepEmParameters.hh"
+#include "G4HepEmDataJsonIO.hh"
+#include "G4HepEmTLData.hh"
+#include "G4HepEmRandomEngine.hh"
+
+// Local includes:
+#include "URandom.hh"
+#include "Geometry.hh"
+#include "PrimaryGenerator.hh"
+#include "Results.hh"
+#include "EventLoop.hh"
+#include "ResourceUsage.hh"
+#include "PhysicsData.hh"
+#include "ToolSetup.hh"
+
+// System includes:
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+// NOTE: this is Unix specific!
+#include <getopt.h>
+
+
+/** Configuration of the optimizer (set by the input arguments).*/
+struct OptimizeParameters {
+  std::string         fParticleName      { "e-" };                       ///< primary particle name: {"e-", "e+" or "gamma"}
+  double              fParticleEnergy    { 10000.0 };                    ///< primary energy in [MeV]
+  int                 fNumLayers         { 50 };                         ///< number of layers in the calorimeter
+  double              fThicknessAbsorber { 2.3 };                        ///< initial thickness of the absorber in [mm]
+  double              fThicknessGap      { 5.7 };                        ///< initial thickness of the gap in [mm]
+  std::vector<double> fBarEdep;                                          ///< weights of the mean edeps per layer in the objective (all 1 if empty)
+  std::string         fOptimizedParams   { "abs:gap" };                  ///< the optimized thicknesses: "abs", "gap" or "abs:gap"
+  std::string         fOptimizer         { "adam" };                     ///< the optimizer: "adam" or "sgd"
+  double              fLearningRate      { 0.05 };                       ///< learning rate (step size)
+  int                 fNumIterations     { 50 };                         ///< number of iterations
+  int                 fNumEvents         { 100 };                        ///< number of events per iteration
+  double              fMinThickness      { 0.01 };                       ///< minimum of the optimized thicknesses in [mm]
+  bool                fMaximize          { false };                      ///< maximise the objective (instead of minimising)
+  int                 fRandomSeed        { 1234 };                       ///< seed of the first iteration
+  std::string         fG4HepEmDataFile   { "../data/hepem_data.json" }; ///< the pre-generated data file (with path)
+  std::string         fTrajectoryFile    { "optimization_trajectory" };  ///< the file of the trajectory
+};
+
+
+static struct option options[] = {
+  {"primary-particle      (possible particle names: e-, e+ and gamma)     - default: e-"          , required_argument, 0, 'p'},
+  {"primary-energy        (in internal [MeV] units)                       - default: 10000"       , required_argument, 0, 'e'},
+  {"number-of-layers      (number of layers in the calorimeter)           - default: 50"          , required_argument, 0, 'l'},
+  {"absorber-thickness    (initial value in internal [mm] units)          - default: 2.3"         , required_argument, 0, 'a'},
+  {"gap-thickness         (initial value in internal [mm] units)          - default: 5.7"         , required_argument, 0, 'g'},
+  {"edep-bars             (weights of the edeps in the objective)         - default: 1:1:...:1"   , required_argument, 0, 'b'},
+  {"parameters            (optimized thicknesses: abs, gap or abs:gap)    - default: abs:gap"     , required_argument, 0, 'P'},
+  {"optimizer             (adam or sgd)                                   - default: adam"        , required_argument, 0, 'o'},
+  {"learning-rate         (step size of the updates)                      - default: 0.05"        , required_argument, 0, 'r'},
+  {"number-of-iterations                                                  - default: 50"          , required_argument, 0, 'i'},
+  {"number-of-events      (number of events per iteration)                - default: 100"         , required_argument, 0, 'n'},
+  {"min-thickness         (minimum of the thicknesses in [mm])            - default: 0.01"        , required_argument, 0, 'm'},
+  {"maximize              (maximise the objective instead of minimising)"                         , no_argument      , 0, 'x'},
+  {"random-seed           (seed of the first iteration)                   - default: 1234"        , required_argument, 0, 's'},
+  {"g4hepem-data-file     (the pre-generated data file with its path)     - default: ../data/hepem_data", required_argument, 0, 'd'},
+  {"trajectory-file       (file of the objective and parameter trajectory)- default: optimization_trajectory", required_argument, 0, 't'},
+  {"help"                                                                                          , no_argument      , 0, 'h'},
+  {0, 0, 0, 0}
+};
+
+static void Help() {
+  std::cout<<"\n === Usage: HepEmShow-optimize [OPTIONS] \n"<<std::endl;
+  for (int i = 0; options[i].name != NULL; i++) {
+    printf("\t-%c  --%s\n", options[i].val, options[i].name);
+  }
+}
+
+static void GetOpt(int argc, char *argv[], OptimizeParameters& param) {
+  while (true) {
+    int c, optidx = 0;
+    c = getopt_long(argc, argv, "hp:e:l:a:g:b:P:o:r:i:n:m:xs:d:t:", options, &optidx);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 'p':
+       param.fParticleName = optarg;
+       CheckParticleName(param.fParticleName, Help);
+       break;
+    case 'e': param.fParticleEnergy    = std::stod(optarg); break;
+    case 'l': param.fNumLayers         = std::stoi(optarg); break;
+    case 'a': param.fThicknessAbsorber = std::stod(optarg); break;
+    case 'g': param.fThicknessGap      = std::stod(optarg); break;
+    case 'b': {
+       param.fBarEdep.clear();
+       std::string arg(optarg);
+       size_t pos = 0;
+       while (pos < arg.size()) {
+         size_t sep = arg.find(':', pos);
+         if (sep == std::string::npos) sep = arg.size();
+         param.fBarEdep.push_back(std::stod(arg.substr(pos, sep-pos)));
+         pos = sep+1;
+       }
+       break;
+    }
+    case 'P':
+       param.fOptimizedParams = optarg;
+       if ( !(param.fOptimizedParams=="abs" || param.fOptimizedParams=="gap" || param.fOptimizedParams=="abs:gap") ) {
+         std::cout << "\n *** Unknown optimized parameters -P: " << optarg << " (abs, gap or abs:gap)" << std::endl;
+         Help();
+         exit(-1);
+       }
+       break;
+    case 'o':
+       param.fOptimizer = optarg;
+       if ( !(param.fOptimizer=="adam" || param.fOptimizer=="sgd") ) {
+         std::cout << "\n *** Unknown optimizer -o: " << optarg << " (adam or sgd)" << std::endl;
+         Help();
+         exit(-1);
+       }
+       break;
+    case 'r': param.fLearningRate      = std::stod(optarg); break;
+    case 'i': param.fNumIterations     = std::stoi(optarg); break;
+    case 'n': param.fNumEvents         = std::stoi(optarg); break;
+    case 'm': param.fMinThickness      = std::stod(optarg); break;
+    case 'x': param.fMaximize          = true; break;
+    case 's': param.fRandomSeed        = std::stoi(optarg); break;
+    case 'd':
+       param.fG4HepEmDataFile = G4HepEmDataFileName(optarg);
+       break;
+    case 't': param.fTrajectoryFile    = optarg; break;
+    case 'h':
+    default:
+       Help();
+       exit(-1);
+    }
+  }
+  if (param.fNumLayers < 1 || param.fNumEvents < 1 || param.fNumIterations < 1) {
+    printf("\n *** The number of layers (-l), events (-n) and iterations (-i) must be at least 1! \n");
+    Help();
+    exit(-1);
+  }
+  if (!(param.fLearningRate > 0.0) || param.fMinThickness < 0.0) {
+    printf("\n *** The learning rate (-r) must be > 0 and the minimum thickness (-m) >= 0! \n");
+    Help();
+    exit(-1);
+  }
+}
+
+
+/** Adam or SGD update of one parameter (minimisation).*/
+struct ParameterUpdate {
+  double fM { 0.0 };  ///< moving average of the gradient (adam)
+  double fV { 0.0 };  ///< moving average of the squared gradient (adam)
+
+  /** The step to add to the parameter in the given (1-based) iteration with the given gradient.*/
+  double Step(const OptimizeParameters& param, int iteration, double grad) {
+    if (param.fOptimizer == "sgd") {
+      return -param.fLearningRate*grad;
+    }
+    const double beta1 = 0.9, beta2 = 0.999, eps = 1.0E-8;
+    fM = beta1*fM + (1.0 - beta1)*grad;
+    fV = beta2*fV + (1.0 - beta2)*grad*grad;
+    const double mHat = fM/(1.0 - std::pow(beta1, iteration));
+    const double vHat = fV/(1.0 - std::pow(beta2, iteration));
+    return -param.fLearningRate*mHat/(std::sqrt(vHat) + eps);
+  }
+};
+
+
+int main(int argc, char* argv[]) {
+  OptimizeParameters param;
+  GetOpt(argc, argv, param);
+  #ifndef CODI_REVERSE
+    std::cerr << " *** HepEmShow-optimize requires the derivatives of a reverse-mode AD build (G4HepEm configured with reverse-mode CoDiPack)!" << std::endl;
+    return 1;
+  #else
+  //
+  // the G4HepEm data, TL-data, random engine, geometry and primary generator are set up only once
+  Geometry             theGeometry;
+  theGeometry.SetNumLayers(param.fNumLayers);
+  G4HepEmState* theState = LoadG4HepEmState(param.fG4HepEmDataFile, theGeometry.GetMaterialIndices());
+  if (theState == nullptr) {
+    return 1;
+  }
+  URandom              theURnd(param.fRandomSeed);
+  G4HepEmRandomEngine  theRandomEngine(&theURnd);
+  G4HepEmTLData        theTLData;
+  theTLData.SetRandomEngine(&theRandomEngine);
+  PrimaryGenerator     thePrimaryGenerator;
+  //
+  const bool   optAbs = param.fOptimizedParams != "gap";
+  const bool   optGap = param.fOptimizedParams != "abs";
+  const double sign   = param.fMaximize ? -1.0 : 1.0;
+  double thickAbs = param.fThicknessAbsorber;
+  double thickGap = param.fThicknessGap;
+  ParameterUpdate updateAbs, updateGap;
+  //
+  std::ofstream traj(param.fTrajectoryFile);
+  traj << "# iteration abs[mm] gap[mm] objective grad-abs grad-abs-error grad-gap grad-gap-error time[s]\n";
+  traj << std::setprecision(10);
+  std::cout << " === HepEmShow-optimize: " << param.fOptimizer << " over the " << param.fOptimizedParams << " thickness(es), "
+            << param.fNumIterations << " iterations of " << param.fNumEvents << " events ("
+            << (param.fMaximize ? "maximising" : "minimising") << " the objective)" << std::endl;
+  std::cout << std::setw(6) << "iter" << std::setw(12) << "abs [mm]" << std::setw(12) << "gap [mm]" << std::setw(15) << "objective"
+            << std::setw(15) << "grad-abs" << std::setw(15) << "grad-gap" << std::endl;
+  for (int it = 0; it < param.fNumIterations; ++it) {
+    // simulate the batch of this iteration with the current thicknesses
+    const double start = GetWallTime();
+    theURnd.SetSeed(param.fRandomSeed + it);
+    SetUpGeometry(theGeometry, param.fNumLayers, thickAbs, thickGap);
+    SetUpPrimaryGenerator(thePrimaryGenerator, param.fParticleName, param.fParticleEnergy, theGeometry);
+    Results theResult;
+    InitResults(theResult, theGeometry.GetNumLayers());
+    theResult.fComputeDerivatives = true;
+    for (std::size_t i = 0; i < theResult.barEdep.size(); ++i) {
+      theResult.barEdep[i] = param.fBarEdep.empty() ? 1.0 : (i < param.fBarEdep.size() ? param.fBarEdep[i] : 0.0);
+    }
+    EventLoop::ProcessEvents(theTLData, *theState, thePrimaryGenerator, theGeometry, theResult, param.fNumEvents, 0);
+    // the objective and its gradient (the latter with its standard error)
+    double objective = 0.0;
+    for (std::size_t i = 0; i < theResult.fEdepPerLayer_Acc.size(); ++i) {
+      objective += theResult.barEdep[i]*theResult.fEdepPerLayer_Acc[i].getMean();
+    }
+    const double gradAbs    = theResult.barThicknessAbsorber.getMean();
+    const double gradGap    = theResult.barThicknessGap.getMean();
+    const double gradAbsErr = std::sqrt(std::max(0.0, theResult.barThicknessAbsorber.getVar())/param.fNumEvents);
+    const double gradGapErr = std::sqrt(std::max(0.0, theResult.barThicknessGap.getVar())/param.fNumEvents);
+    traj << it << " " << thickAbs << " " << thickGap << " " << objective << " "
+         << gradAbs << " " << gradAbsErr << " " << gradGap << " " << gradGapErr << " " << GetWallTime() - start << std::endl;
+    std::cout << std::setprecision(6) << std::setw(6) << it << std::setw(12) << thickAbs << std::setw(12) << thickGap
+              << std::setw(15) << objective << std::setw(15) << gradAbs << std::setw(15) << gradGap << std::endl;
+    // update the optimized thicknesses (kept above the minimum)
+    if (optAbs) {
+      thickAbs = std::max(param.fMinThickness, thickAbs + updateAbs.Step(param, it+1, sign*gradAbs));
+    }
+    if (optGap) {
+      thickGap = std::max(param.fMinThickness, thickGap + updateGap.Step(param, it+1, sign*gradGap));
+    }
+  }
+  std::cout << " === HepEmShow-optimize: final thicknesses: absorber = " << thickAbs << " [mm], gap = " << thickGap
+            << " [mm] (trajectory in " << param.fTrajectoryFile << ")" << std::endl;
+  //
+  FreeG4HepEmData(theState->fData);
+  delete theState;
+  return 0;
+  #endif
+}
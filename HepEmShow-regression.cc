@@ -0,0 +1,366 @@
+/**
+ * @file    HepEmShow-regression.cc
+ *
+ * @brief The main funtion of the `HepEmShow-regression` throughput and physics
+ *        output regression test (driven by CTest).
+ *
+ * Each test simulates one configuration (primary particle, energy and geometry)
+ * in-process, in `-b` independent batches of events (the batch `i` is seeded by
+ * the `-s` seed plus `i`) that are merged at the end. Then:
+ * - the usual `HepEmShow` outputs (`edeps` and the `hist_*` histograms) are
+ *   written by `WriteResults()` into the working directory and compared to the
+ *   references stored under `<reference-dir>/<configuration>/`. A value is
+ *   accepted if it differs from the reference by less than `-k` standard
+ *   deviations of the difference. The standard deviation of each value is
+ *   estimated from its batch means (stored in the `sigmas` file for the
+ *   references)
+ * - the measured events/s and steps/s are compared to the stored baseline
+ *   `<reference-dir>/<configuration>/baseline.json`. A throughput drop beyond
+ *   the `-t` fraction of the baseline is a failure.
+ *
+ * The test is skipped (return code 77) if the references of the configuration
+ * are not available. They can be (re-)generated by running the test with `-u`
+ * (or with the `HEPEMSHOW_UPDATE_REFERENCES` environment variable set), which
+ * is what the `regression-update` target does.
+ *
+ * @note The derivatives are not computed in AD builds (the tests are primal
+ * runs) so the outputs are the same in all builds. The references depend on the
+ * `G4HepEm` data file and the throughput baseline on the machine.
+ */
+
+// G4HepEm related includes
+#include "G4HepEmState.hh"
+#include "G4HepEmData.hh"
+#include "G4HepEmParameters.hh"
+#include "G4HepEmDataJsonIO.hh"
+#include "G4HepEmTLData.hh"
+#include "G4HepEmRandomEngine.hh"
+
+// Local includes:
+#include "URandom.hh"
+#include "Geometry.hh"
+#include "PrimaryGenerator.hh"
+#include "Results.hh"
+#include "EventLoop.hh"
+#include "ResourceUsage.hh"
+#include "PhysicsData.hh"
+#include "ToolSetup.hh"
+
+// System includes:
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+
+// NOTE: this is Unix specific!
+#include <getopt.h>
+#include <sys/stat.h>
+
+
+/** The return code of a skipped test (see the `SKIP_RETURN_CODE` test property).*/
+static const int kSkipReturnCode = 77;
+
+/** The output files of `WriteResults()` that are compared to the references.*/
+static const std::vector<std::string> kOutputFiles = { "edeps", "hist_Edep_PerLayer", "hist_GamTrackL_PerLayer", "hist_ElPosTrackL_PerLayer" };
+
+
+/** Configuration of the regression test (set by the input arguments).*/
+struct RegressionParameters {
+  std::string fConfigName        { "" };                          ///< name of the configuration (sub-directory of the references)
+  std::string fParticleName      { "e-" };                        ///< primary particle name: {"e-", "e+" or "gamma"}
+  double      fParticleEnergy    { 1000.0 };                      ///< primary energy in [MeV]
+  double      fThicknessAbsorber { 2.3 };                         ///< thickness of the absorber in [mm]
+  double      fThicknessGap      { 5.7 };                         ///< thickness of the gap in [mm]
+  int         fNumEvents         { 2000 };                        ///< number of events (all batches)
+  int         fNumBatches        { 20 };                          ///< number of batches (to estimate the statistical uncertainties)
+  int         fRandomSeed        { 1234 };                        ///< seed of the first batch
+  std::string fG4HepEmDataFile   { "../data/hepem_data.json" };  ///< the pre-generated data file (with path)
+  std::string fReferenceDir      { "" };                          ///< directory of the references
+  double      fNumSigma          { 5.0 };                         ///< tolerance of the outputs in standard deviations
+  double      fThreshold         { 0.25 };                        ///< tolerated relative drop of the throughput
+  bool        fUpdate            { false };                       ///< (re-)generate the references instead of comparing
+};
+
+
+static struct option options[] = {
+  {"configuration-name    (name of the configuration i.e. references)     - required"          , required_argument, 0, 'c'},
+  {"primary-particle      (possible particle names: e-, e+ and gamma)     - default: e-"        , required_argument, 0, 'p'},
+  {"primary-energy        (in internal [MeV] units)                       - default: 1000"      , required_argument, 0, 'e'},
+  {"absorber-thickness    (in internal [mm] units)                        - default: 2.3"       , required_argument, 0, 'a'},
+  {"gap-thickness         (in internal [mm] units)                        - default: 5.7"       , required_argument, 0, 'g'},
+  {"number-of-events      (number of events in all batches)               - default: 2000"      , required_argument, 0, 'n'},
+  {"number-of-batches     (to estimate the statistical uncertainties)     - default: 20"        , required_argument, 0, 'b'},
+  {"random-seed           (seed of the first batch)                       - default: 1234"      , required_argument, 0, 's'},
+  {"g4hepem-data-file     (the pre-generated data file with its path)     - default: ../data/hepem_data", required_argument, 0, 'd'},
+  {"reference-dir         (directory of the stored references)            - required"          , required_argument, 0, 'r'},
+  {"num-sigma             (tolerance of the outputs in std. deviations)   - default: 5"         , required_argument, 0, 'k'},
+  {"threshold             (tolerated relative drop of the throughput)     - default: 0.25"      , required_argument, 0, 't'},
+  {"update                (re-generate the references of the configuration)"                   , no_argument      , 0, 'u'},
+  {"help"                                                                                       , no_argument      , 0, 'h'},
+  {0, 0, 0, 0}
+};
+
+static void Help() {
+  std::cout<<"\n === Usage: HepEmShow-regression [OPTIONS] \n"<<std::endl;
+  for (int i = 0; options[i].name != NULL; i++) {
+    printf("\t-%c  --%s\n", options[i].val, options[i].name);
+  }
+}
+
+static void GetOpt(int argc, char *argv[], RegressionParameters& param) {
+  while (true) {
+    int c, optidx = 0;
+    c = getopt_long(argc, argv, "hc:p:e:a:g:n:b:s:d:r:k:t:u", options, &optidx);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 'c': param.fConfigName = optarg; break;
+    case 'p':
+       param.fParticleName = optarg;
+       CheckParticleName(param.fParticleName, Help);
+       break;
+    case 'e': param.fParticleEnergy    = std::stod(optarg); break;
+    case 'a': param.fThicknessAbsorber = std::stod(optarg); break;
+    case 'g': param.fThicknessGap      = std::stod(optarg); break;
+    case 'n': param.fNumEvents         = std::stoi(optarg); break;
+    case 'b': param.fNumBatches        = std::stoi(optarg); break;
+    case 's': param.fRandomSeed        = std::stoi(optarg); break;
+    case 'd':
+       param.fG4HepEmDataFile = G4HepEmDataFileName(optarg);
+       break;
+    case 'r': param.fReferenceDir = optarg; break;
+    case 'k': param.fNumSigma     = std::stod(optarg); break;
+    case 't': param.fThreshold    = std::stod(optarg); break;
+    case 'u': param.fUpdate       = true; break;
+    case 'h':
+    default:
+       Help();
+       exit(-1);
+    }
+  }
+  if (param.fConfigName.empty() || param.fReferenceDir.empty()) {
+    printf("\n *** The configuration name (-c) and the reference directory (-r) are required! \n");
+    Help();
+    exit(-1);
+  }
+  if (param.fNumBatches < 2 || param.fNumEvents < param.fNumBatches) {
+    printf("\n *** At least 2 batches (-b) with at least one event (-n) each are required! \n");
+    Help();
+    exit(-1);
+  }
+  if (std::getenv("HEPEMSHOW_UPDATE_REFERENCES") != nullptr) {
+    param.fUpdate = true;
+  }
+}
+
+
+/** The compared values of the outputs (in the order of `kOutputFiles`, then the values in each) obtained from the results of `numEvents` events.*/
+static std::vector<double> OutputValues(const Results& res, int numEvents) {
+  std::vector<double> vals;
+  // `edeps`: mean and mean of squares of the energy deposit per layer
+  for (size_t i = 0; i < res.fEdepPerLayer_Acc.size(); ++i) {
+    vals.push_back(res.fEdepPerLayer_Acc[i].getMean());
+    vals.push_back(res.fEdepPerLayer_Acc[i].getMeanSq());
+  }
+  // `hist_*`: mean per event
+  const Hist* hists[3] = { &res.fEdepPerLayer, &res.fGammaTrackLenghtPerLayer, &res.fElPosTrackLenghtPerLayer };
+  for (const Hist* h : hists) {
+    for (int i = 0; i < h->GetNumBins(); ++i) {
+      vals.push_back(GET_VALUE(h->GetY()[i])/numEvents);
+    }
+  }
+  return vals;
+}
+
+/** Reads the compared values (the last column of `hist_*` and the 2 columns of `edeps`) of the output files from the given directory.*/
+static bool ReadOutputValues(const std::string& dir, std::vector<double>& vals) {
+  vals.clear();
+  for (const std::string& name : kOutputFiles) {
+    std::ifstream is(dir + name);
+    if (!is) {
+      return false;
+    }
+    std::string line;
+    while (std::getline(is, line)) {
+      std::istringstream ls(line);
+      std::vector<double> cols;
+      double d;
+      while (ls >> d) cols.push_back(d);
+      if (cols.empty()) continue;
+      if (name == "edeps") {
+        vals.push_back(cols[0]);
+        vals.push_back(cols.size() > 1 ? cols[1] : 0.0);
+      } else {
+        vals.push_back(cols.back());
+      }
+    }
+  }
+  return true;
+}
+
+static void CopyFile(const std::string& from, const std::string& to) {
+  std::ifstream is(from, std::ios::binary);
+  std::ofstream os(to, std::ios::binary);
+  os << is.rdbuf();
+}
+
+/** Reads the value of the given key from the (flat) baseline JSON file (returns a negative value if not found).*/
+static double ReadBaselineValue(const std::string& fileName, const std::string& key) {
+  std::ifstream is(fileName);
+  std::stringstream ss;
+  ss << is.rdbuf();
+  const std::string json = ss.str();
+  const std::string qkey = "\"" + key + "\"";
+  size_t pos = json.find(qkey);
+  if (pos == std::string::npos) return -1.0;
+  pos = json.find(':', pos);
+  return pos == std::string::npos ? -1.0 : std::stod(json.substr(pos+1));
+}
+
+
+int main(int argc, char* argv[]) {
+  RegressionParameters param;
+  GetOpt(argc, argv, param);
+  const std::string refDir = param.fReferenceDir + "/" + param.fConfigName + "/";
+  //
+  G4HepEmState* theState = LoadG4HepEmState(param.fG4HepEmDataFile, Geometry().GetMaterialIndices(), 0);
+  if (theState == nullptr) {
+    return 1;
+  }
+  //
+  // simulate the batches (only the event processing is timed)
+  Results theTotalResult;
+  std::vector< std::vector<double> > batchValues;
+  double wallTime = 0.0;
+  int    numDone  = 0;
+  for (int ib = 0; ib < param.fNumBatches; ++ib) {
+    const int numEvents = param.fNumEvents/param.fNumBatches + (ib < param.fNumEvents%param.fNumBatches ? 1 : 0);
+    URandom              theURnd(param.fRandomSeed + ib);
+    G4HepEmRandomEngine  theRandomEngine(&theURnd);
+    G4HepEmTLData        theTLData;
+    theTLData.SetRandomEngine(&theRandomEngine);
+    Geometry theGeometry;
+    SetUpGeometry(theGeometry, theGeometry.GetNumLayers(), param.fThicknessAbsorber, param.fThicknessGap);
+    PrimaryGenerator thePrimaryGenerator;
+    SetUpPrimaryGenerator(thePrimaryGenerator, param.fParticleName, param.fParticleEnergy, theGeometry);
+    Results theResult;
+    InitResults(theResult, theGeometry.GetNumLayers());
+    theResult.fComputeDerivatives = false;
+    if (ib == 0) {
+      InitResults(theTotalResult, theGeometry.GetNumLayers());
+      theTotalResult.fComputeDerivatives = false;
+    }
+    const double start = GetWallTime();
+    EventLoop::ProcessEvents(theTLData, *theState, thePrimaryGenerator, theGeometry, theResult, numEvents, 0);
+    wallTime += GetWallTime() - start;
+    numDone  += numEvents;
+    batchValues.push_back(OutputValues(theResult, numEvents));
+    MergeResults(theTotalResult, theResult);
+  }
+  // standard deviation of the mean of each output value from the batch means
+  const int numBatches = param.fNumBatches;
+  std::vector<double> outSigmas(batchValues[0].size(), 0.0);
+  for (size_t i = 0; i < outSigmas.size(); ++i) {
+    double mean = 0.0, mean2 = 0.0;
+    for (int ib = 0; ib < numBatches; ++ib) {
+      mean  += batchValues[ib][i]/numBatches;
+      mean2 += batchValues[ib][i]*batchValues[ib][i]/numBatches;
+    }
+    outSigmas[i] = std::sqrt(std::max(0.0, mean2 - mean*mean)/(numBatches-1));
+  }
+  const double numSteps       = GET_VALUE(theTotalResult.fNumStepsGamma + theTotalResult.fNumStepsElPos);
+  const double eventsPerSecond = numDone/wallTime;
+  const double stepsPerSecond  = numSteps/wallTime;
+  // write the outputs into the working directory
+  WriteResults(theTotalResult, numDone);
+  std::cout << std::setprecision(6)
+            << " === " << param.fConfigName << ": " << eventsPerSecond << " events/s "
+            << stepsPerSecond << " steps/s" << std::endl;
+  //
+  FreeG4HepEmData(theState->fData);
+  delete theState;
+  //
+  // update the references of this configuration if required
+  if (param.fUpdate) {
+    mkdir(param.fReferenceDir.c_str(), 0755);
+    mkdir(refDir.c_str(), 0755);
+    for (const std::string& name : kOutputFiles) {
+      CopyFile(name, refDir + name);
+    }
+    std::ofstream sigmas(refDir + "sigmas");
+    sigmas << std::setprecision(14);
+    for (double sigma : outSigmas) {
+      sigmas << sigma << "\n";
+    }
+    std::ofstream os(refDir + "baseline.json");
+    os << std::setprecision(10)
+       << "{\n"
+       << "  \"configuration\": \"" << param.fConfigName << "\",\n"
+       << "  \"numEvents\": " << numDone << ",\n"
+       << "  \"eventsPerSecond\": " << eventsPerSecond << ",\n"
+       << "  \"stepsPerSecond\": " << stepsPerSecond << "\n"
+       << "}\n";
+    std::cout << " === References updated in " << refDir << std::endl;
+    return 0;
+  }
+  //
+  // compare the outputs to the references
+  std::vector<double> outVals, refVals;
+  if (!ReadOutputValues(refDir, refVals)) {
+    std::cout << " === No references in " << refDir << ": skipped (run with -u to generate them)." << std::endl;
+    return kSkipReturnCode;
+  }
+  ReadOutputValues("", outVals);
+  if (outVals.size() != refVals.size()) {
+    std::cout << " *** The number of output values (" << outVals.size() << ") differs from the references ("
+              << refVals.size() << ")!" << std::endl;
+    return 1;
+  }
+  // standard deviations of the reference values (the same as the outputs if not available)
+  std::vector<double> refSigmas;
+  std::ifstream sigmas(refDir + "sigmas");
+  double sigma;
+  while (sigmas >> sigma) {
+    refSigmas.push_back(sigma);
+  }
+  if (refSigmas.size() != outSigmas.size()) {
+    refSigmas = outSigmas;
+  }
+  int numFailed = 0;
+  double maxDeviation = 0.0;
+  for (size_t i = 0; i < outVals.size(); ++i) {
+    const double sigmaDiff = std::sqrt(outSigmas[i]*outSigmas[i] + refSigmas[i]*refSigmas[i]);
+    const double tol       = param.fNumSigma*sigmaDiff + 1.0E-9*std::max(std::abs(refVals[i]), 1.0);
+    if (sigmaDiff > 0.0) {
+      maxDeviation = std::max(maxDeviation, std::abs(outVals[i] - refVals[i])/sigmaDiff);
+    }
+    if (!(std::abs(outVals[i] - refVals[i]) <= tol)) {
+      if (numFailed < 10) {
+        std::cout << " *** Output value #" << i << " = " << outVals[i] << " differs from the reference "
+                  << refVals[i] << " by more than " << tol << " (" << param.fNumSigma << " sigma)" << std::endl;
+      }
+      ++numFailed;
+    }
+  }
+  std::cout << " === Maximum deviation of the outputs from the references: " << maxDeviation << " sigma" << std::endl;
+  //
+  // compare the throughput to the baseline
+  bool isSlower = false;
+  const double baseSteps = ReadBaselineValue(refDir + "baseline.json", "stepsPerSecond");
+  if (baseSteps > 0.0) {
+    const double change = stepsPerSecond/baseSteps - 1.0;
+    std::cout << " === Throughput change compared to the baseline: " << 100.0*change << " %" << std::endl;
+    if (change < -param.fThreshold) {
+      std::cout << " *** Throughput drop beyond the threshold of " << 100.0*param.fThreshold << " %!" << std::endl;
+      isSlower = true;
+    }
+  }
+  if (numFailed > 0) {
+    std::cout << " *** " << numFailed << " of the " << outVals.size() << " output values differ from the references!" << std::endl;
+  }
+  return (numFailed > 0 || isSlower) ? 1 : 0;
+}
@@ -0,0 +1,375 @@
+/**
+ * @file    HepEmShow-sweep.cc
+ *
+ * @brief The main funtion of the `HepEmShow-sweep` in-process parameter sweep.
+ *
+ * Simulates a list or grid of configurations (points) of the primary particle,
+ * primary energy and geometry (absorber and gap thicknesses, number of layers)
+ * in one process: the `G4HepEm` data are loaded only once and each worker of
+ * the sweep constructs its `G4HepEmTLData`, random engine, `Geometry` and
+ * `PrimaryGenerator` only once, then reconfigures the latter two for each of
+ * its points (`SetUpGeometry()` and `SetUpPrimaryGenerator()`).
+ *
+ * The points are given in the sweep file (`-f`). Each (non-empty and non-comment)
+ * line is a set of `key=values` with the keys `particle`, `energy` [MeV],
+ * `abs` [mm], `gap` [mm] and `layers`. The values are either a comma separated
+ * list (e.g. `energy=1000,10000`) or an inclusive `from:to:step` range (e.g.
+ * `abs=1.0:3.0:0.5`), and a line gives the grid of all their combinations. The
+ * missing keys take the values of the input arguments, e.g.
+ * ```
+ *    # 2 x 5 points: the particle and the number of layers are given by -p and -l
+ *    energy=1000,10000 abs=1.0:3.0:0.5
+ *    # 3 more points
+ *    particle=gamma energy=10000 gap=0,2.85,5.7
+ * ```
+ *
+ * Each point is simulated with `-n` events, all started from the `-s` seed
+ * (i.e. the points use common random numbers). The usual `HepEmShow` outputs
+ * (`edeps` and the `hist_*` histograms) of the point `k` are written by
+ * `WriteResults()` into the `<output-dir>/point_<k>` directory, while the
+ * configuration and the main results of all points are summarised in the
+ * `<output-dir>/sweep_summary` file.
+ *
+ * The points are distributed over the `-j` workers (a pool of threads that
+ * share the read-only `G4HepEm` data), each simulating its points one after
+ * the other.
+ *
+ * @note The derivatives are not computed (the points are primal runs) so the
+ * outputs are the same in all builds. Reverse-mode AD builds with a global tape
+ * use a single worker.
+ */
+
+// G4HepEm related includes
+#include "G4HepEmState.hh"
+#include "G4HepEmData.hh"
+#include "G4HepEmParameters.hh"
+#include "G4HepEmDataJsonIO.hh"
+#include "G4HepEmTLData.hh"
+#include "G4HepEmRandomEngine.hh"
+
+// Local includes:
+#include "URandom.hh"
+#include "Geometry.hh"
+#include "PrimaryGenerator.hh"
+#include "Results.hh"
+#include "EventLoop.hh"
+#include "ResourceUsage.hh"
+#include "PhysicsData.hh"
+#include "ToolSetup.hh"
+
+// System includes:
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+
+// NOTE: this is Unix specific!
+#include <getopt.h>
+#include <sys/stat.h>
+
+
+/** Configuration of the sweep (set by the input arguments).*/
+struct SweepParameters {
+  std::string fSweepFile         { "" };                          ///< the file with the points of the sweep
+  std::string fOutputDir         { "sweep" };                     ///< directory of the outputs (one sub-directory per point)
+  std::string fParticleName      { "e-" };                        ///< default primary particle name: {"e-", "e+" or "gamma"}
+  double      fParticleEnergy    { 1000.0 };                      ///< default primary energy in [MeV]
+  double      fThicknessAbsorber { 2.3 };                         ///< default thickness of the absorber in [mm]
+  double      fThicknessGap      { 5.7 };                         ///< default thickness of the gap in [mm]
+  int         fNumLayers         { 50 };                          ///< default number of layers in the calorimeter
+  int         fNumEvents         { 100 };                         ///< number of events per point
+  int         fRandomSeed        { 1234 };                        ///< seed of each point
+  int         fNumWorkers        { 1 };                           ///< number of workers (points simulated concurrently)
+  std::string fG4HepEmDataFile   { "../data/hepem_data.json" };  ///< the pre-generated data file (with path)
+};
+
+/** One point of the sweep and its main results.*/
+struct SweepPoint {
+  std::string fParticleName;            ///< primary particle name
+  double      fParticleEnergy;          ///< primary energy in [MeV]
+  double      fThicknessAbsorber;       ///< thickness of the absorber in [mm]
+  double      fThicknessGap;            ///< thickness of the gap in [mm]
+  int         fNumLayers;               ///< number of layers
+  // results
+  double      fEdepAbs         { 0.0 }; ///< mean energy deposit in the absorber in [MeV]
+  double      fEdepAbsRMS      { 0.0 }; ///< standard deviation of the energy deposit in the absorber in [MeV]
+  double      fEdepGap         { 0.0 }; ///< mean energy deposit in the gap in [MeV]
+  double      fEdepGapRMS      { 0.0 }; ///< standard deviation of the energy deposit in the gap in [MeV]
+  double      fEventsPerSecond { 0.0 }; ///< event throughput of the point
+};
+
+
+static struct option options[] = {
+  {"sweep-file            (the points of the sweep, see the file doc)     - required"          , required_argument, 0, 'f'},
+  {"output-dir            (one sub-directory per point)                   - default: sweep"     , required_argument, 0, 'o'},
+  {"primary-particle      (possible particle names: e-, e+ and gamma)     - default: e-"        , required_argument, 0, 'p'},
+  {"primary-energy        (in internal [MeV] units)                       - default: 1000"      , required_argument, 0, 'e'},
+  {"absorber-thickness    (in internal [mm] units)                        - default: 2.3"       , required_argument, 0, 'a'},
+  {"gap-thickness         (in internal [mm] units)                        - default: 5.7"       , required_argument, 0, 'g'},
+  {"number-of-layers      (number of layers in the calorimeter)           - default: 50"        , required_argument, 0, 'l'},
+  {"number-of-events      (number of events per point)                    - default: 100"       , required_argument, 0, 'n'},
+  {"random-seed           (seed of each point)                            - default: 1234"      , required_argument, 0, 's'},
+  {"number-of-workers     (points simulated concurrently)                 - default: 1"         , required_argument, 0, 'j'},
+  {"g4hepem-data-file     (the pre-generated data file with its path)     - default: ../data/hepem_data", required_argument, 0, 'd'},
+  {"help"                                                                                       , no_argument      , 0, 'h'},
+  {0, 0, 0, 0}
+};
+
+static void Help() {
+  std::cout<<"\n === Usage: HepEmShow-sweep [OPTIONS] \n"<<std::endl;
+  for (int i = 0; options[i].name != NULL; i++) {
+    printf("\t-%c  --%s\n", options[i].val, options[i].name);
+  }
+}
+
+static void GetOpt(int argc, char *argv[], SweepParameters& param) {
+  while (true) {
+    int c, optidx = 0;
+    c = getopt_long(argc, argv, "hf:o:p:e:a:g:l:n:s:j:d:", options, &optidx);
+    if (c == -1)
+      break;
+    switch (c) {
+    case 'f': param.fSweepFile = optarg; break;
+    case 'o': param.fOutputDir = optarg; break;
+    case 'p':
+       param.fParticleName = optarg;
+       CheckParticleName(param.fParticleName, Help);
+       break;
+    case 'e': param.fParticleEnergy    = std::stod(optarg); break;
+    case 'a': param.fThicknessAbsorber = std::stod(optarg); break;
+    case 'g': param.fThicknessGap      = std::stod(optarg); break;
+    case 'l': param.fNumLayers         = std::stoi(optarg); break;
+    case 'n': param.fNumEvents         = std::stoi(optarg); break;
+    case 's': param.fRandomSeed        = std::stoi(optarg); break;
+    case 'j': param.fNumWorkers        = std::stoi(optarg); break;
+    case 'd':
+       param.fG4HepEmDataFile = G4HepEmDataFileName(optarg);
+       break;
+    case 'h':
+    default:
+       Help();
+       exit(-1);
+    }
+  }
+  if (param.fSweepFile.empty()) {
+    printf("\n *** The sweep file (-f) is required! \n");
+    Help();
+    exit(-1);
+  }
+  if (param.fNumLayers < 1 || param.fNumEvents < 1 || param.fNumWorkers < 1) {
+    printf("\n *** The number of layers (-l), events (-n) and workers (-j) must be at least 1! \n");
+    Help();
+    exit(-1);
+  }
+}
+
+
+/** The values of a key of the sweep file: a comma separated list or an inclusive `from:to:step` range.*/
+static std::vector<std::string> ParseValues(const std::string& key, const std::string& str) {
+  std::vector<std::string> vals;
+  if (key != "particle" && std::count(str.begin(), str.end(), ':') == 2) {
+    const size_t p1 = str.find(':');
+    const size_t p2 = str.find(':', p1+1);
+    const double from = std::stod(str.substr(0, p1));
+    const double to   = std::stod(str.substr(p1+1, p2-p1-1));
+    const double step = std::stod(str.substr(p2+1));
+    if (!(step > 0.0) || to < from) {
+      throw std::invalid_argument("invalid range " + str);
+    }
+    // the tolerance avoids loosing the end of the range by rounding
+    const int num = static_cast<int>(std::floor((to - from)/step + 1.0E-9)) + 1;
+    for (int i = 0; i < num; ++i) {
+      std::ostringstream ss;
+      ss << std::setprecision(12) << from + i*step;
+      vals.push_back(ss.str());
+    }
+    return vals;
+  }
+  std::istringstream ss(str);
+  std::string val;
+  while (std::getline(ss, val, ',')) {
+    if (!val.empty()) {
+      vals.push_back(val);
+    }
+  }
+  if (vals.empty()) {
+    throw std::invalid_argument("no values");
+  }
+  return vals;
+}
+
+/** Reads the points of the sweep from the given file (the grid of each line in the order of the file).*/
+static std::vector<SweepPoint> ReadSweepPoints(const SweepParameters& param) {
+  static const std::vector<std::string> kKeys = { "particle", "energy", "abs", "gap", "layers" };
+  std::ifstream is(param.fSweepFile);
+  if (!is) {
+    std::cerr << " *** Cannot open the sweep file " << param.fSweepFile << std::endl;
+    exit(1);
+  }
+  std::vector<SweepPoint> points;
+  std::string line;
+  int lineNum = 0;
+  while (std::getline(is, line)) {
+    ++lineNum;
+    line = line.substr(0, line.find('#'));
+    std::istringstream ls(line);
+    std::map<std::string, std::vector<std::string>> values;
+    std::string token;
+    try {
+      while (ls >> token) {
+        const size_t pos = token.find('=');
+        const std::string key = token.substr(0, pos);
+        if (pos == std::string::npos || std::find(kKeys.begin(), kKeys.end(), key) == kKeys.end()) {
+          throw std::invalid_argument("unknown key " + token);
+        }
+        values[key] = ParseValues(key, token.substr(pos+1));
+      }
+      if (values.empty()) {
+        continue;
+      }
+      // the missing keys take the values of the input arguments
+      std::ostringstream ss;
+      ss << std::setprecision(12);
+      if (!values.count("particle")) values["particle"] = { param.fParticleName };
+      if (!values.count("energy"))   { ss.str(""); ss << param.fParticleEnergy;    values["energy"] = { ss.str() }; }
+      if (!values.count("abs"))      { ss.str(""); ss << param.fThicknessAbsorber; values["abs"]    = { ss.str() }; }
+      if (!values.count("gap"))      { ss.str(""); ss << param.fThicknessGap;      values["gap"]    = { ss.str() }; }
+      if (!values.count("layers"))   values["layers"] = { std::to_string(param.fNumLayers) };
+      // the grid of the line
+      for (const std::string& particle : values["particle"]) {
+        if (!IsValidParticleName(particle)) {
+          throw std::invalid_argument("unknown primary particle name " + particle);
+        }
+        for (const std::string& energy : values["energy"]) {
+          for (const std::string& abs : values["abs"]) {
+            for (const std::string& gap : values["gap"]) {
+              for (const std::string& layers : values["layers"]) {
+                SweepPoint point;
+                point.fParticleName      = particle;
+                point.fParticleEnergy    = std::stod(energy);
+                point.fThicknessAbsorber = std::stod(abs);
+                point.fThicknessGap      = std::stod(gap);
+                point.fNumLayers         = std::stoi(layers);
+                if (point.fParticleEnergy <= 0.0 || point.fThicknessAbsorber < 0.0 || point.fThicknessGap < 0.0 || point.fNumLayers < 1) {
+                  throw std::invalid_argument("invalid value");
+                }
+                points.push_back(point);
+              }
+            }
+          }
+        }
+      }
+    } catch (const std::exception& e) {
+      std::cerr << " *** Invalid line " << lineNum << " of the sweep file " << param.fSweepFile
+                << " (" << e.what() << "): " << line << std::endl;
+      exit(1);
+    }
+  }
+  return points;
+}
+
+
+/** Writes the configuration and the main results of all points into the summary file of the sweep.*/
+static void WriteSummary(const std::string& fileName, const std::vector<SweepPoint>& points, int numEvents) {
+  std::ofstream os(fileName);
+  os << "# point particle energy[MeV] abs[mm] gap[mm] layers events edepAbs[MeV] rmsAbs[MeV] edepGap[MeV] rmsGap[MeV] events/s\n";
+  os << std::setprecision(8);
+  for (size_t ip = 0; ip < points.size(); ++ip) {
+    const SweepPoint& p = points[ip];
+    os << ip << " " << p.fParticleName << " " << p.fParticleEnergy << " " << p.fThicknessAbsorber << " "
+       << p.fThicknessGap << " " << p.fNumLayers << " " << numEvents << " " << p.fEdepAbs << " " << p.fEdepAbsRMS << " "
+       << p.fEdepGap << " " << p.fEdepGapRMS << " " << p.fEventsPerSecond << "\n";
+  }
+}
+
+
+int main(int argc, char* argv[]) {
+  SweepParameters param;
+  GetOpt(argc, argv, param);
+  std::vector<SweepPoint> points = ReadSweepPoints(param);
+  if (points.empty()) {
+    std::cerr << " *** No points in the sweep file " << param.fSweepFile << std::endl;
+    return 1;
+  }
+  //
+  // the G4HepEm data are loaded only once (shared, read-only, by all workers)
+  G4HepEmState* theState = LoadG4HepEmState(param.fG4HepEmDataFile, Geometry().GetMaterialIndices());
+  if (theState == nullptr) {
+    return 1;
+  }
+  mkdir(param.fOutputDir.c_str(), 0755);
+  //
+  int numWorkers = std::min<int>(param.fNumWorkers, points.size());
+  #if defined(CODI_REVERSE) && !defined(HEPEMSHOW_THREAD_LOCAL_TAPE)
+    // the (global) tape cannot be shared by the workers
+    numWorkers = 1;
+  #endif
+  std::cout << " === HepEmShow-sweep: " << points.size() << " points of " << param.fNumEvents
+            << " events with " << numWorkers << " worker(s)" << std::endl;
+  //
+  // each worker takes the next point till all points are done
+  std::atomic<size_t> theNextPoint{0};
+  std::mutex          theOutputMutex;
+  auto theWorker = [&]() {
+    URandom              theURnd(param.fRandomSeed);
+    G4HepEmRandomEngine  theRandomEngine(&theURnd);
+    G4HepEmTLData        theTLData;
+    theTLData.SetRandomEngine(&theRandomEngine);
+    Geometry             theGeometry;
+    PrimaryGenerator     thePrimaryGenerator;
+    for (size_t ip = theNextPoint++; ip < points.size(); ip = theNextPoint++) {
+      SweepPoint& point = points[ip];
+      // reconfigure the geometry and the primary generator (the random engine starts from the seed)
+      theURnd.SetSeed(param.fRandomSeed);
+      SetUpGeometry(theGeometry, point.fNumLayers, point.fThicknessAbsorber, point.fThicknessGap);
+      SetUpPrimaryGenerator(thePrimaryGenerator, point.fParticleName, point.fParticleEnergy, theGeometry);
+      const std::string pointDir = param.fOutputDir + "/point_" + std::to_string(ip);
+      mkdir(pointDir.c_str(), 0755);
+      Results theResult;
+      InitResults(theResult, theGeometry.GetNumLayers(), pointDir);
+      theResult.fComputeDerivatives = false;
+      //
+      const double start = GetWallTime();
+      EventLoop::ProcessEvents(theTLData, *theState, thePrimaryGenerator, theGeometry, theResult, param.fNumEvents, 0);
+      point.fEventsPerSecond = param.fNumEvents/(GetWallTime() - start);
+      const double norm = 1.0/param.fNumEvents;
+      point.fEdepAbs    = GET_VALUE(theResult.fEdepAbs)*norm;
+      point.fEdepAbsRMS = std::sqrt(std::abs(GET_VALUE(theResult.fEdepAbs2)*norm - point.fEdepAbs*point.fEdepAbs));
+      point.fEdepGap    = GET_VALUE(theResult.fEdepGap)*norm;
+      point.fEdepGapRMS = std::sqrt(std::abs(GET_VALUE(theResult.fEdepGap2)*norm - point.fEdepGap*point.fEdepGap));
+      // the outputs of the points are written one after the other
+      std::lock_guard<std::mutex> lock(theOutputMutex);
+      std::cout << "\n === Point " << ip << ": " << point.fParticleName << " of " << point.fParticleEnergy << " [MeV], "
+                << point.fNumLayers << " layers of " << point.fThicknessAbsorber << " [mm] absorber and "
+                << point.fThicknessGap << " [mm] gap (outputs in " << pointDir << ")" << std::endl;
+      WriteResults(theResult, param.fNumEvents);
+    }
+  };
+  const double start = GetWallTime();
+  std::vector<std::thread> theWorkers;
+  for (int iw = 1; iw < numWorkers; ++iw) {
+    theWorkers.emplace_back(theWorker);
+  }
+  theWorker();
+  for (std::thread& worker : theWorkers) {
+    worker.join();
+  }
+  const double wallTime = GetWallTime() - start;
+  //
+  WriteSummary(param.fOutputDir + "/sweep_summary", points, param.fNumEvents);
+  std::cout << "\n === HepEmShow-sweep: " << points.size() << " points completed within t = " << wallTime
+            << " [s] (summary in " << param.fOutputDir << "/sweep_summary)" << std::endl;
+  //
+  FreeG4HepEmData(theState->fData);
+  delete theState;
+  return 0;
+}
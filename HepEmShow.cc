@@ -10,18 +10,22 @@
  * - reading the input arguments provided at the execution of the application
  *   into an `InputParameters` object. (Note, these arguments provide
  *   configuration options).
+ * - constructing and setting up the application `Geometry` according to the
+ *   provided configuration input arguments (in `InputParameters`)
  * - loading the `G4HepEm` data and parameters from file into a `G4HepEmState`
- *   (see the note below)
+ *   (see the note below), checked to provide the material-cuts couples used by
+ *   the `Geometry` (see `LoadG4HepEmState()`)
  * - constructing a `G4HepEmTLData` (also required by `G4HepEm` and encapsulates
  *   the random number generator and some track buffers) with its random number
  *   generator (utilising the local `URandom` generator)
- * - constructing and setting up the application `Geometry` according to the
- *   provided configuration input arguments (in `InputParameters`)
  * - constructing and setting up the `PrimaryGenerator` of the application according
  *   to the provided configuration input arguments (in `InputParameters`)
  * - constructing and setting up a `Results` structure that will be used to collect
  *   some data during the simulation
- * - the `EventLoop::ProcessEvents` method is invoked then to **perform the simulation**
+ * - the `EventLoop::ProcessEvents` method (or `EventLoop::ProcessEventsMT` when more
+ *   than one worker thread is required, `EventLoop::ProcessEventsTrackParallel` when
+ *   the tracks of each event are shared by more than one worker thread) is invoked
+ *   then to **perform the simulation**
  * - the simulation results are witten to file (and to the standard output) by
  *   invoking `WriteResults()` (from the `Results`)
  *
@@ -56,6 +60,15 @@
 #include "PrimaryGenerator.hh"
 #include "Results.hh"
 #include "EventLoop.hh"
+#include "EventRecord.hh"
+#include "Timeline.hh"
+#include "RunReport.hh"
+#include "LiveMetrics.hh"
+#include "StoppingRule.hh"
+#include "FiniteDifference.hh"
+#include "ResourceUsage.hh"
+#include "PhysicsData.hh"
+#include "NumaPlacement.hh"
 
 
 // System includes:
@@ -63,6 +76,9 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
 
 #include "sys/time.h"
 #include <ctime>
@@ -77,10 +93,23 @@ int main(int argc, char* argv[]) {
   GetOpt(argc, argv, theInputParameters);
 
 
+  // `Geometry` describes the application geometry (i.e. the simplified sampling calorimeter)
+  //  here we construct the application geometry and set its configurable properties like
+  //  #layers, thickness of absorber and gap, etc.
+  Geometry theGeometry;
+  theGeometry.SetNumLayers(theInputParameters.fGeometry.fNumLayers);
+  theGeometry.SetAbsThick(theInputParameters.fGeometry.fThicknessAbsorber);
+  theGeometry.SetGapThick(theInputParameters.fGeometry.fThicknessGap);
+  theGeometry.SetCaloSizeYZ(theInputParameters.fGeometry.fSizeTransverse);
+
+
   // `G4HepEmState` encapsulates G4HepEm (physics related) `data` and `parameters`
   // here we load the generated/delivered G4HepEm data from the file given as an input argument
-  std::ifstream jsonIS{ theInputParameters.fG4HepEmDataFile.c_str() };
-  G4HepEmState* theState = G4HepEmStateFromJson(jsonIS);
+  // (checked to provide the material-cuts couples used by the geometry)
+  G4HepEmState* theState = LoadG4HepEmState(theInputParameters.fG4HepEmDataFile, theGeometry.GetMaterialIndices(), theInputParameters.fRunVerbosity);
+  if (theState == nullptr) {
+    return 1;
+  }
 
 
   // `G4HepEmTLData` encapsulates "thread-local" (i.e. TL) data like:
@@ -96,16 +125,6 @@ int main(int argc, char* argv[]) {
   theTLData->SetRandomEngine(theRandomEngine);
 
 
-  // `Geometry` describes the application geometry (i.e. the simplified sampling calorimeter)
-  //  here we construct the application geometry and set its configurable properties like
-  //  #layers, thickness of absorber and gap, etc.
-  Geometry theGeometry;
-  theGeometry.SetNumLayers(theInputParameters.fGeometry.fNumLayers);
-  theGeometry.SetAbsThick(theInputParameters.fGeometry.fThicknessAbsorber);
-  theGeometry.SetGapThick(theInputParameters.fGeometry.fThicknessGap);
-  theGeometry.SetCaloSizeYZ(theInputParameters.fGeometry.fSizeTransverse);
-
-
   // `PrimaryGenerator` is used to produce primary particle/track when starting a new event
   // here we construct the primary generator and set its configurable properties like
   // primary particle kinetic energy and its type, i.e. e-,e+ or gamma (determined the charge), etc.
@@ -123,30 +142,141 @@ int main(int argc, char* argv[]) {
   // here we construct one and set the properties of its histograms (as thery are used
   // to collect data per-layer and the number of layer is configurable input argument)
   Results theResult;
-  theResult.fEdepPerLayer.ReSet("hist_Edep_PerLayer", 0, theGeometry.GetNumLayers(), theGeometry.GetNumLayers());
-  theResult.fEdepPerLayer_CurrentEvent.ReSet("hist_Edep_PerLayer_CurrentEvent", 0, theGeometry.GetNumLayers(), theGeometry.GetNumLayers());
-  theResult.fEdepPerLayer_Acc.resize(50);
-  #ifdef CODI_FORWARD
-    theResult.fEdepPerLayer_AccD.resize(50);
-  #endif
+  InitResults(theResult, theGeometry.GetNumLayers());
+  // derivatives are not computed in primal runs of AD builds (`--mode primal`)
+  theResult.fComputeDerivatives = (theInputParameters.fRunMode != "primal");
+  // the hardware performance counters are measured only if required (`-c`)
+  theResult.fMeasurePerfCounters = theInputParameters.fPerfCounters;
   #ifdef CODI_REVERSE
-    theResult.barEdep.resize(50,0.);
-    for(int i=0; i<50; i++){
+    for(size_t i=0; i<theResult.barEdep.size(); i++){
        if(i<theInputParameters.barEdep.size()){
           theResult.barEdep[i] = theInputParameters.barEdep[i];
        }
     }
   #endif
-  theResult.fGammaTrackLenghtPerLayer.ReSet("hist_GamTrackL_PerLayer", 0, theGeometry.GetNumLayers(), theGeometry.GetNumLayers());
-  theResult.fElPosTrackLenghtPerLayer.ReSet("hist_ElPosTrackL_PerLayer", 0, theGeometry.GetNumLayers(), theGeometry.GetNumLayers());
+
+
+  // the timeline of the run is recorded only if required (`-T`)
+  if (!theInputParameters.fTraceFile.empty()) {
+    Timeline::Enable(theInputParameters.fTraceTracks);
+    Timeline::SetThreadName("main");
+  }
 
 
   // here we start the event processing: generate the required number of event and simulte each event.
-  EventLoop::ProcessEvents(*theTLData, *theState, thePrimaryGenerator, theGeometry, theResult, theInputParameters.fPrimaryAndEvents.fNumEvents, theInputParameters.fRunVerbosity);
+  // NOTE: each worker thread has its own TL-data, random engine, geometry, etc. in case of more than one worker
+  // NOTE: when recording or replaying events, each event starts from its own seed (see `EventRecord`)
+  const double theWallStart = GetWallTime();
+  const double theCPUStart  = GetCPUTime();
+  int numEvents = theInputParameters.fPrimaryAndEvents.fNumEvents;
+  // the live metrics are written only if required (`-M`): one publishing slot per worker thread
+  if (!theInputParameters.fMetricsFile.empty()) {
+    const bool isMT = theInputParameters.fRecordFile.empty() && theInputParameters.fReplayFile.empty();
+    LiveMetrics::Start(theInputParameters.fMetricsFile, theInputParameters.fMetricsInterval, numEvents,
+                       theGeometry.GetNumLayers(), isMT ? theInputParameters.fNumThreads : 1);
+  }
+  const std::uint64_t theRunSeed = GET_VALUE(theInputParameters.fPrimaryAndEvents.fRandomSeed);
+  // the perturbed configurations are simulated in lockstep with the nominal one only if required (`-F`)
+  std::unique_ptr<FiniteDifference> theFiniteDifference;
+  if (!theInputParameters.fFDParameter.empty()) {
+    FiniteDifference::EParameter theFDParameter;
+    FiniteDifference::ParameterByName(theInputParameters.fFDParameter, theFDParameter);
+    theFiniteDifference.reset(new FiniteDifference(theFDParameter, theInputParameters.fFDStep));
+  }
+  if (!theInputParameters.fRecordFile.empty()) {
+    std::vector<EventRecord> theEvents = CreateEventRecords(numEvents, theRunSeed);
+    EventLoop::ProcessEventList(*theTLData, *theURnd, *theState, thePrimaryGenerator, theGeometry, theResult, theEvents, theInputParameters.fRunVerbosity);
+    Timeline::Begin(Timeline::kOutput);
+    WriteEventRecords(theInputParameters.fRecordFile, theEvents);
+    Timeline::End(Timeline::kOutput, 1);
+  } else if (!theInputParameters.fReplayFile.empty()) {
+    std::vector<EventRecord> theEvents = SelectEventRecords(ReadEventRecords(theInputParameters.fReplayFile), theInputParameters.fReplaySelection, theRunSeed);
+    numEvents = theEvents.size();
+    LiveMetrics::SetNumEventsTotal(numEvents);
+    EventLoop::ProcessEventList(*theTLData, *theURnd, *theState, thePrimaryGenerator, theGeometry, theResult, theEvents, theInputParameters.fRunVerbosity);
+  } else if (theFiniteDifference) {
+    numEvents = EventLoop::ProcessEventsFD(*theTLData, *theURnd, *theState, thePrimaryGenerator, theGeometry, theResult, *theFiniteDifference, numEvents, theRunSeed, theInputParameters.fRunVerbosity);
+  } else {
+    // the event loop might be terminated earlier by the stopping rule (only if required by `-E` or `-W`)
+    std::unique_ptr<StoppingRule> theStoppingRule;
+    if (theInputParameters.fTargetRelError > 0.0 || theInputParameters.fTimeBudget > 0.0) {
+      theStoppingRule.reset(new StoppingRule(theInputParameters.fTargetRelError, theInputParameters.fTimeBudget, theInputParameters.fPrecisionLayers,
+                                             theInputParameters.fPrecisionDerivatives, theInputParameters.fBatchSize));
+    }
+    // the workers might be pinned to NUMA nodes, each node with its own replica of the G4HepEm state (only if required by `-A`)
+    std::unique_ptr<NumaPlacement> thePlacement;
+    if (!theInputParameters.fNumaNodes.empty()) {
+      thePlacement.reset(new NumaPlacement());
+      if (!thePlacement->SelectNodes(theInputParameters.fNumaNodes)) {
+        std::cerr << " *** Unknown NUMA node in -A " << theInputParameters.fNumaNodes << " (the nodes of the machine are listed below)" << std::endl;
+        thePlacement->SelectNodes("all");
+        thePlacement->Print(std::cerr);
+        return 1;
+      }
+      const std::vector<int> theMaterialIndices = theGeometry.GetMaterialIndices();
+      thePlacement->fReplicaLoader = [&theInputParameters, theMaterialIndices]() {
+        return LoadG4HepEmState(theInputParameters.fG4HepEmDataFile, theMaterialIndices, 0);
+      };
+    }
+    if (theInputParameters.fNumTrackThreads > 1) {
+      numEvents = EventLoop::ProcessEventsTrackParallel(*theState, thePrimaryGenerator, theGeometry, theResult, theInputParameters.fPrimaryAndEvents.fNumEvents, theInputParameters.fNumTrackThreads, GET_VALUE(theInputParameters.fPrimaryAndEvents.fRandomSeed), theInputParameters.fRunVerbosity,
+                                                        theStoppingRule.get());
+    } else if (theInputParameters.fNumThreads > 1 || thePlacement) {
+      numEvents = EventLoop::ProcessEventsMT(*theState, thePrimaryGenerator, theGeometry, theResult, theInputParameters.fPrimaryAndEvents.fNumEvents, theInputParameters.fNumThreads, GET_VALUE(theInputParameters.fPrimaryAndEvents.fRandomSeed), theInputParameters.fRunVerbosity, theStoppingRule.get(),
+                                             thePlacement.get());
+    } else {
+      numEvents = EventLoop::ProcessEvents(*theTLData, *theState, thePrimaryGenerator, theGeometry, theResult, theInputParameters.fPrimaryAndEvents.fNumEvents, theInputParameters.fRunVerbosity, theStoppingRule.get());
+    }
+  }
+
+
+  LiveMetrics::Stop();
+  const double theWallTime = GetWallTime() - theWallStart;
+  const double theCPUTime  = GetCPUTime()  - theCPUStart;
+
+
+  // the machine-readable report of the run is written only if required (`-J`)
+  // NOTE: before `WriteResults` as that normalises some of the results
+  if (!theInputParameters.fRunReportFile.empty()) {
+    RunReport theReport;
+    theReport.fRunMode    = theInputParameters.fRunMode;
+    theReport.fNumThreads = std::max(theInputParameters.fNumThreads, theInputParameters.fNumTrackThreads);
+    theReport.fNumConfigs = theFiniteDifference ? 3 : 1;
+    theReport.fWallTime   = theWallTime;
+    theReport.fCPUTime    = theCPUTime;
+    theReport.AddParameter("numberOfLayers", theInputParameters.fGeometry.fNumLayers);
+    theReport.AddParameter("absorberThickness_mm", GET_VALUE(theInputParameters.fGeometry.fThicknessAbsorber));
+    theReport.AddParameter("gapThickness_mm", GET_VALUE(theInputParameters.fGeometry.fThicknessGap));
+    theReport.AddParameter("transverseSize_mm", GET_VALUE(theInputParameters.fGeometry.fSizeTransverse));
+    theReport.AddParameter("primaryParticle", theInputParameters.fPrimaryAndEvents.fParticleName);
+    theReport.AddParameter("primaryEnergy_MeV", GET_VALUE(theInputParameters.fPrimaryAndEvents.fParticleEnergy));
+    theReport.AddParameter("numberOfEvents", theInputParameters.fPrimaryAndEvents.fNumEvents);
+    theReport.AddParameter("randomSeed", GET_VALUE(theInputParameters.fPrimaryAndEvents.fRandomSeed));
+    theReport.AddParameter("g4hepemDataFile", theInputParameters.fG4HepEmDataFile);
+    theReport.AddParameter("preset", theInputParameters.fPreset.empty() ? "default" : theInputParameters.fPreset);
+    theReport.AddParameter("numaNodes", theInputParameters.fNumaNodes);
+    theReport.AddParameter("numberOfThreads", theInputParameters.fNumThreads);
+    theReport.AddParameter("trackThreads", theInputParameters.fNumTrackThreads);
+    theReport.AddParameter("mode", theInputParameters.fRunMode);
+    theReport.AddParameter("recordEvents", theInputParameters.fRecordFile);
+    theReport.AddParameter("replayEvents", theInputParameters.fReplayFile);
+    theReport.AddParameter("replaySelection", theInputParameters.fReplaySelection);
+    theReport.AddParameter("fdParameter", theInputParameters.fFDParameter);
+    theReport.AddParameter("fdStep", theInputParameters.fFDStep);
+    WriteRunReport(theInputParameters.fRunReportFile, theReport, theResult, numEvents);
+  }
 
 
   // here we summarise the results and write them to file (the histograms) or to the screen
-  WriteResults(theResult, theInputParameters.fPrimaryAndEvents.fNumEvents);
+  Timeline::Begin(Timeline::kOutput);
+  WriteResults(theResult, numEvents);
+  if (theFiniteDifference) {
+    theFiniteDifference->Write("fdEdeps", std::cout);
+  }
+  Timeline::End(Timeline::kOutput, 0);
+  if (!theInputParameters.fTraceFile.empty()) {
+    Timeline::Write(theInputParameters.fTraceFile);
+  }
 
 
   // delete objects
@@ -0,0 +1,107 @@
+#ifndef ALLOCTRACKER_HH
+#define ALLOCTRACKER_HH
+
+/**
+ * @file    AllocTracker.hh
+ * @struct  AllocStatistics
+ *
+ * @brief Optional tracking of the heap allocations in the event loop, per event and per phase.
+ *
+ * When `HEPEMSHOW_ALLOC_TRACKING` is defined (CMake option `-DHepEmShow_ALLOC_TRACKING=ON`),
+ * the global `operator new` (all forms, see `AllocTracker.cc`) and, with the GNU C
+ * library, `malloc`, `calloc` and `realloc` are replaced by ones that count the allocations and the allocated bytes of the calling thread in
+ * the current phase of the simulation. The phases are set by the same phase
+ * markers (`HEPEMSHOW_PHASE_BEGIN/END/SCOPE`, see `PhaseTimers.hh`) that drive
+ * the phase timers, and the allocations outside the event processing are not
+ * counted.
+ *
+ * The `EventLoop` collects the allocations of each event into the `AllocStatistics`
+ * of its `Results` (per phase, per event and their maximum) that are merged over
+ * the threads and printed by `WriteResults()`. After the first event of each
+ * thread (i.e. in the steady state, when the track stack and the other buffers
+ * have already been grown), any allocation in the stepping loop (track stack,
+ * navigation, physics, secondary stacking and scoring phases) is reported with
+ * the ID of the first such event and its phase: the target of the primal build
+ * is zero allocations per step.
+ *
+ * @note The aligned allocations (`posix_memalign`, `aligned_alloc` and the aligned
+ * `operator new`) are not tracked, neither are the C allocations with other C
+ * libraries than the GNU one.
+ */
+
+#include "PhaseTimers.hh"
+
+#ifdef HEPEMSHOW_ALLOC_TRACKING
+
+#include <cstdint>
+#include <iostream>
+
+struct AllocStatistics {
+  std::uint64_t fAllocs[kNumPhases] = {};     ///< number of allocations per phase
+  std::uint64_t fBytes[kNumPhases]  = {};     ///< allocated bytes per phase
+  std::uint64_t fNumEvents              {0};  ///< number of events
+  std::uint64_t fNumEventsWithAllocs    {0};  ///< number of events with at least one allocation
+  std::uint64_t fMaxAllocsPerEvent      {0};  ///< maximum number of allocations in one event
+  std::uint64_t fNumSteadySteppingAllocs{0};  ///< allocations in the stepping loop after the first event (of each thread)
+  int           fFirstSteadyEventID    {-1};  ///< ID of the first event with such allocations (-1 if none)
+  int           fFirstSteadyPhase      {-1};  ///< phase of the first such allocation
+
+  /** Adds the statistics of the other (e.g. of an other thread) to this.*/
+  void Merge(const AllocStatistics& other);
+
+  /** Prints the allocations per phase and per event and reports the allocations in the steady-state stepping loop.*/
+  void Print(std::ostream& os) const;
+};
+
+
+namespace AllocTracker {
+
+  /** Sets the current phase of the calling thread (-1: allocations are not counted) and returns the previous.*/
+  int SetPhase(int phase);
+
+  /** Snapshot of the allocation counters of the calling thread at the start of an event (or the counts of an event).*/
+  struct EventSnapshot {
+    std::uint64_t fAllocs[kNumPhases];
+    std::uint64_t fBytes[kNumPhases];
+  };
+
+  /** Takes the snapshot of the allocation counters of the calling thread.*/
+  void BeginEvent(EventSnapshot& snapshot);
+
+  /** Adds the allocations of the calling thread since the snapshot to the statistics of the given event.*/
+  void EndEvent(const EventSnapshot& snapshot, AllocStatistics& stat, int eventID);
+
+  /** Adds the allocations of the calling thread since the snapshot to the given counts and takes a new snapshot
+   *  (the allocations of an event simulated by more threads, see `EventLoop::ProcessEventsTrackParallel()`).*/
+  void Collect(EventSnapshot& snapshot, EventSnapshot& counts);
+
+  /** Adds the counts to the other counts.*/
+  void Add(const EventSnapshot& counts, EventSnapshot& to);
+
+  /** Adds the allocation counts of the given event (e.g. collected from more threads) to the statistics.*/
+  void AddEvent(const EventSnapshot& counts, AllocStatistics& stat, int eventID);
+}
+
+
+/** Sets the given phase for the enclosing scope (restores the previous at the end).*/
+class ScopedAllocPhase {
+public:
+  explicit ScopedAllocPhase(int phase) : fPrevious(AllocTracker::SetPhase(phase)) {}
+ ~ScopedAllocPhase() { AllocTracker::SetPhase(fPrevious); }
+private:
+  int fPrevious;
+};
+
+#define HEPEMSHOW_ALLOC_BEGIN_(phase)  const int allocPrevious_##phase = AllocTracker::SetPhase(phase)
+#define HEPEMSHOW_ALLOC_END_(phase)    AllocTracker::SetPhase(allocPrevious_##phase)
+#define HEPEMSHOW_ALLOC_SCOPE_(phase)  ScopedAllocPhase allocScope_##phase(phase)
+
+#else
+
+#define HEPEMSHOW_ALLOC_BEGIN_(phase)
+#define HEPEMSHOW_ALLOC_END_(phase)
+#define HEPEMSHOW_ALLOC_SCOPE_(phase)
+
+#endif // HEPEMSHOW_ALLOC_TRACKING
+
+#endif // ALLOCTRACKER_HH
@@ -16,6 +16,8 @@
  * their secondary tracks.
  */
 
+#include <vector>
+#include <cstdint>
 
 class G4HepEmTLData;
 class G4HepEmState;
@@ -24,6 +26,15 @@ class G4HepEmTrack;
 class PrimaryGenerator;
 class Geometry;
 class Results;
+class TrackStack;
+class URandom;
+class PerfCounters;
+class StoppingRule;
+class FiniteDifference;
+class MultiLevelMC;
+class NumaPlacement;
+
+struct EventRecord;
 
 class EventLoop {
 
@@ -46,19 +57,153 @@ public:
    * @param thePrimaryGenerator the primary generator that is used to generate primary track(s) at the beginning of each event (only one primary track per event in our case now)
    * @param theGeometry the geometry of the application in which the input track history is simulated
    * @param theResult the data structure that holds all the infomation needs to be collected during the simulation.
+   * @param numEventToSimulate number of events required to be simulated (the maximum number of events if `theStoppingRule` is given)
+   * @param verbosity to control the verbosity of printouts reporting progress and state of the event processing
+   * @param theStoppingRule optional rule to terminate the event loop earlier (checked after each batch of events)
+   * @return the number of simulated events
+   */
+  static int ProcessEvents(G4HepEmTLData& theTLData, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, int numEventToSimulate, int verbosity, StoppingRule* theStoppingRule = nullptr);
+
+  /** Simulates the events given by their records, each started from its own seed.
+   *
+   * Before each event, the random number generator is re-seeded by the recorded seed of the event so each event can be
+   * reproduced individually (see `EventRecord`). The cost of each event (energy deposit, number of steps and time) is
+   * written into its record after the event. This is used both to record all events in a primal pass (with records
+   * created by `CreateEventRecords()`) and to replay a selected subset of them (e.g. with taping enabled in an AD pass).
+   *
+   * @param theTLData a `G4HepEm` specific (thread local) object (see `ProcessEvents()`)
+   * @param theURnd the random number generator used by the random engine of `theTLData`
+   * @param theState a `G4HepEm` specific object that stores pointers to the top level `G4HepEm` data structure and parameters
+   * @param thePrimaryGenerator the primary generator that is used to generate primary track(s) at the beginning of each event
+   * @param theGeometry the geometry of the application in which the input track history is simulated
+   * @param theResult the data structure that holds all the infomation needs to be collected during the simulation.
+   * @param theEvents the records of the events to simulate (their cost is updated)
+   * @param verbosity to control the verbosity of printouts reporting progress and state of the event processing
+   */
+  static void ProcessEventList(G4HepEmTLData& theTLData, URandom& theURnd, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, std::vector<EventRecord>& theEvents, int verbosity);
+
+  /** Generates and simulates the required number of events in the nominal and in the two perturbed configurations in lockstep.
+   *
+   * Each event is simulated three times: in the minus and plus configurations (copies of the input `Geometry` and `PrimaryGenerator`
+   * perturbed by `FiniteDifference::Perturb()`) and in the nominal configuration, each time started from the same seed of the event
+   * (`URandom::EventSeed()` of `runSeed` and the event ID), i.e. with common random numbers. The nominal configuration is simulated
+   * exactly as in `ProcessEventList()` (with derivatives in AD builds) into `theResult`, while the difference of the energy deposits
+   * of the perturbed configurations is accumulated by `theFiniteDifference` after each event.
+   *
+   * @param theTLData a `G4HepEm` specific (thread local) object (see `ProcessEvents()`)
+   * @param theURnd the random number generator used by the random engine of `theTLData`
+   * @param theState a `G4HepEm` specific object that stores pointers to the top level `G4HepEm` data structure and parameters
+   * @param thePrimaryGenerator the primary generator of the nominal configuration
+   * @param theGeometry the geometry of the nominal configuration
+   * @param theResult the data structure that holds all the infomation collected in the nominal configuration (its
+   *        phase timers, step statistics and peak `TrackStack` depth cover all three configurations)
+   * @param theFiniteDifference the perturbed parameter and the accumulators of the differences
+   * @param numEventToSimulate number of events required to be simulated
+   * @param runSeed the seed of the run (the seeds of the events are derived from it)
+   * @param verbosity to control the verbosity of printouts reporting progress and state of the event processing
+   * @return the number of simulated events
+   */
+  static int ProcessEventsFD(G4HepEmTLData& theTLData, URandom& theURnd, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, FiniteDifference& theFiniteDifference, int numEventToSimulate, std::uint64_t runSeed, int verbosity);
+
+  /** Generates and simulates the required number of events of one level of the multilevel Monte Carlo estimator.
+   *
+   * Each event is simulated with the fine `G4HepEm` state of the level and (on levels > 0) with the coarse state of the
+   * previous level, both started from the same seed of the event (`URandom::EventSeed()` of `levelSeed` and the event ID), so
+   * the energy deposits of the two are correlated. The results and the cost of both are accumulated by `theMultiLevelMC`
+   * after each event.
+   *
+   * @param theTLData a `G4HepEm` specific (thread local) object (see `ProcessEvents()`)
+   * @param theURnd the random number generator used by the random engine of `theTLData`
+   * @param theFineState the `G4HepEm` state of the level
+   * @param theCoarseState the `G4HepEm` state of the previous level (`nullptr` on level 0)
+   * @param thePrimaryGenerator the primary generator that is used to generate primary track(s) at the beginning of each event
+   * @param theGeometry the geometry of the application in which the input track history is simulated
+   * @param theFineResult the results of the fine simulation
+   * @param theCoarseResult the results of the coarse simulation (not used on level 0)
+   * @param theMultiLevelMC the estimator that accumulates the events
+   * @param level the index of the level
+   * @param firstEventID the ID of the first event (the events of a level can be simulated in several calls)
    * @param numEventToSimulate number of events required to be simulated
+   * @param levelSeed the seed of the level (the seeds of the events are derived from it)
+   * @return the number of simulated events
+   */
+  static int ProcessEventsCoupled(G4HepEmTLData& theTLData, URandom& theURnd, G4HepEmState& theFineState, G4HepEmState* theCoarseState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry,
+                                  Results& theFineResult, Results& theCoarseResult, MultiLevelMC& theMultiLevelMC, int level, int firstEventID, int numEventToSimulate, std::uint64_t levelSeed);
+
+  /** Generates and simulates the required number of events on several worker threads.
+   *
+   * Each worker thread has its own `G4HepEmTLData` (with its own `URandom` generator), `TrackStack`, copies of the input
+   * `PrimaryGenerator` and `Geometry` and its own (initially empty) `Results`. The events are distributed dynamically among the
+   * workers and each event is simulated as in the sequential `ProcessEvents()` but started from its own seed (`URandom::EventSeed()`
+   * of `seed` and the event ID), so the results do not depend on the number of workers or the scheduling. The per-worker results
+   * are merged into `theResult` (by `MergeResults()`) after all workers completed.
+   *
+   * In reverse-mode AD builds, each worker registers the AD inputs (`pThicknessAbsorber`, `pThicknessGap`, `pParticleEnergy`) and
+   * evaluates the tape of its own events, so the bar values are accumulated per worker and merged at the end. This requires that
+   * the `G4double` type of `G4HepEm` has a thread-local tape (`HEPEMSHOW_THREAD_LOCAL_TAPE`, see the `HepEmShow_THREAD_LOCAL_TAPE`
+   * CMake option): a single worker is used otherwise.
+   *
+   * @param theState the (shared, read-only) `G4HepEm` state
+   * @param thePrimaryGenerator the primary generator configuration (copied by each worker)
+   * @param theGeometry the geometry configuration (copied by each worker)
+   * @param theResult the data structure into which the results of all workers are merged
+   * @param numEventToSimulate number of events required to be simulated (the maximum number of events if `theStoppingRule` is given)
+   * @param numThreads number of worker threads
+   * @param seed the seed of the run (the seeds of the events are derived from it)
    * @param verbosity to control the verbosity of printouts reporting progress and state of the event processing
+   * @param theStoppingRule optional rule to terminate the event loop earlier (checked by each worker after each batch of its events)
+   * @param thePlacement optional NUMA placement of the workers: pinned to the CPUs of their node and using the state replica of their node
+   * @return the number of simulated events
    */
-  static void ProcessEvents(G4HepEmTLData& theTLData, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, int numEventToSimulate, int verbosity);
+  static int ProcessEventsMT(G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, int numEventToSimulate, int numThreads, int seed, int verbosity, StoppingRule* theStoppingRule = nullptr,
+                             const NumaPlacement* thePlacement = nullptr);
+
+  /** Generates and simulates the required number of events one after the other, each by several worker threads.
+   *
+   * This is for a few very high-energy events (e.g. TeV primaries with hundreds of thousands of tracks per event) that
+   * need to be completed quickly: the tracks of each event are shared by the workers instead of the events. The track-stack
+   * of the event is a work pool protected by a mutex: each worker pops one track from the pool, simulates its history by the
+   * `SteppingLoop` with its own `G4HepEmTLData` (with its own `URandom` generator seeded by `seed` + worker ID) and copy of the
+   * input `Geometry`, then pushes the secondaries of the track back into the pool (with new track IDs). The event is completed
+   * when the pool is empty and none of the workers is tracking. Each worker scores into its own per-event buffers (and track
+   * length histograms) that are reduced into `theResult` before the `EndOfEventAction()`. The calling thread is one of the
+   * workers and it also invokes the event actions.
+   *
+   * The results are statistically equivalent but not identical to those of `ProcessEvents()` with the same seed since the
+   * tracks are distributed among the random number streams of the workers dynamically. In forward-mode AD builds, the
+   * tangents are propagated exactly as in `ProcessEvents()`. The tape of an event cannot be shared by the workers in
+   * reverse-mode AD builds: a single worker is used when the derivatives are computed or when the tape is global.
+   *
+   * @param theState the (shared, read-only) `G4HepEm` state
+   * @param thePrimaryGenerator the primary generator that is used to generate primary track(s) at the beginning of each event
+   * @param theGeometry the geometry configuration (copied by each worker)
+   * @param theResult the data structure that holds all the infomation needs to be collected during the simulation.
+   * @param numEventToSimulate number of events required to be simulated (the maximum number of events if `theStoppingRule` is given)
+   * @param numThreads number of worker threads (including the calling thread)
+   * @param seed the base seed of the random number generators of the workers
+   * @param verbosity to control the verbosity of printouts reporting progress and state of the event processing
+   * @param theStoppingRule optional rule to terminate the event loop earlier (checked after each batch of events)
+   * @return the number of simulated events
+   */
+  static int ProcessEventsTrackParallel(G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, int numEventToSimulate, int numThreads, int seed, int verbosity,
+                                        StoppingRule* theStoppingRule = nullptr);
 
 private:
   EventLoop() = delete;
 
+  /** Generates and simulates one event (with the given ID) by using the given track-stack (the hardware counters of the phases are measured if `thePerfCounters` is given).*/
+  static void ProcessOneEvent(G4HepEmTLData& theTLData, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, TrackStack& theTrackStack, int eventID, const PerfCounters* thePerfCounters);
+
   /** Method invoked at the beginning of each event by passing the (single) primary track of the event.*/
   static void BeginOfEventAction(Results& theResult, int eventID, const G4HepEmTrack& thePrimaryTrack, Geometry& theGeometry, PrimaryGenerator& thePrimaryGenerator);
   /** Method invoked at the end of each event.*/
   static void EndOfEventAction(  Results& theResult, int eventID);
 
+  /** Resets the per-event accumulators of the results (at the beginning of each event).*/
+  static void ResetPerEventResults(Results& theResult);
+  /** Adds the per-event accumulators of `from` to those of `to` (the per-event buffers of the workers of `ProcessEventsTrackParallel()`).*/
+  static void AddPerEventResults(Results& to, const Results& from);
+
   /** Method invoked before start tracking of a new track (provided as input argument).*/
   static void BeginOfTrackingAction(Results& theResult, G4HepEmTrack& theTrack);
   /** Method invoked after terminating tracking of a track (provided as input argument).*/
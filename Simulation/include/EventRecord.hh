@@ -0,0 +1,60 @@
+#include "ad_type.h"
+
+
+#ifndef EVENTRECORD_HH
+#define EVENTRECORD_HH
+
+/**
+ * @file    EventRecord.hh
+ * @struct  EventRecord
+ *
+ * @brief Record of the random number generator starting state and cost of one event.
+ *
+ * Event records make possible a two-pass workflow:
+ * - a (fast) primal pass simulates all events, each of them started with its own
+ *   seed of the random number generator (see `URandom::EventSeed()`), and records
+ *   the seed together with the cost (energy deposit, number of steps and time) of
+ *   each event (see the `-r` input argument)
+ * - an AD pass then re-simulates (replays) only a selected subset of these events
+ *   with their recorded seeds (see the `-R` and `-k` input arguments) with taping
+ *   enabled. Each replayed event has the same history as in the primal pass.
+ *
+ * Derivatives estimated on a `random` subset of the events are statistically
+ * equivalent to those estimated on all events (with a larger variance due to the
+ * smaller number of events), while the `top` events (by energy deposit) can be
+ * used to investigate the derivatives of the most costly/extreme events.
+ */
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+struct EventRecord {
+  int           fEventID  {  0  }; ///< ID of the event in the primal pass
+  std::uint64_t fSeed     {  0  }; ///< seed of the random number generator at the start of the event
+  double        fEdep     { 0.0 }; ///< energy deposit in the calorimeter during the event in [MeV]
+  double        fNumSteps { 0.0 }; ///< number of simulation steps during the event
+  double        fTime     { 0.0 }; ///< time of simulating the event in [s]
+};
+
+
+/** Creates the records of the given number of events with their seeds derived from the run seed.*/
+std::vector<EventRecord> CreateEventRecords(int numEvents, std::uint64_t runSeed);
+
+/** Writes the given event records into a file (one event per line).*/
+void WriteEventRecords(const std::string& fileName, const std::vector<EventRecord>& records);
+
+/** Reads event records from a file that was written by `WriteEventRecords()`.*/
+std::vector<EventRecord> ReadEventRecords(const std::string& fileName);
+
+/** Selects a subset of the event records.
+  *
+  * @param records   the event records to select from
+  * @param selection `all`, `random:K` (K events without replacement, uniformly) or `top:K` (the K events with the highest energy deposit)
+  * @param seed      seed used for the `random` selection
+  * @return the selected event records in the order of their event IDs
+  */
+std::vector<EventRecord> SelectEventRecords(const std::vector<EventRecord>& records, const std::string& selection, std::uint64_t seed);
+
+#endif // EVENTRECORD_HH
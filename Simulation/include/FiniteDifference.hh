@@ -0,0 +1,84 @@
+#include "ad_type.h"
+
+
+#ifndef FINITEDIFFERENCE_HH
+#define FINITEDIFFERENCE_HH
+
+/**
+ * @file    FiniteDifference.hh
+ * @class   FiniteDifference
+ *
+ * @brief Lockstep central finite differences of the energy deposits with common random numbers.
+ *
+ * In the finite-difference mode (`-F` input argument), each event is simulated
+ * in the nominal configuration and in the two perturbed configurations with the
+ * selected input parameter (absorber or gap thickness, or primary energy)
+ * shifted by \f$ \pm h \f$ (`-H`), all three started from the same per-event
+ * seed (see `URandom::EventSeed()` and `EventLoop::ProcessEventsFD()`). The
+ * difference quotient \f$ (E^{+}_i - E^{-}_i)/2h \f$ of the energy deposit in
+ * each layer is accumulated event by event, so its variance is the variance of
+ * the paired difference that is much smaller than the
+ * \f$ (\sigma_{+}^2 + \sigma_{-}^2)/4h^2 \f$ of two independent runs, as
+ * long as the perturbed histories stay correlated (i.e. for small \f$ h \f$).
+ * Both variances are reported so the reduction can be checked.
+ *
+ * The nominal configuration gives the usual results (including the derivatives
+ * in AD builds, e.g. to validate them against the finite differences).
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include "accumulator.hh"
+
+struct Results;
+class Geometry;
+class PrimaryGenerator;
+
+class FiniteDifference {
+
+public:
+
+  /** The input parameters that can be perturbed.*/
+  enum EParameter { kAbsorberThickness = 0, kGapThickness, kParticleEnergy };
+
+  /** CTR.
+   *
+   * @param parameter the perturbed input parameter
+   * @param step the (absolute) step \f$ h \f$ in [mm] or [MeV] units
+   */
+  FiniteDifference(EParameter parameter, double step);
+
+  /** The input parameter given by its name: `abs`, `gap` or `energy` (returns false if unknown).*/
+  static bool ParameterByName(const std::string& name, EParameter& parameter);
+
+  /** The perturbed input parameter.*/
+  EParameter GetParameter() const { return fParameter; }
+
+  /** The step \f$ h \f$.*/
+  double GetStep() const { return fStep; }
+
+  /** Sets the perturbed parameter of the given copies of the nominal geometry and primary generator to its nominal value plus `sign` times the step.*/
+  void Perturb(Geometry& theGeometry, PrimaryGenerator& thePrimaryGenerator, double sign) const;
+
+  /** Initialises the accumulators for a calorimeter with the given number of layers.*/
+  void Init(int numLayers);
+
+  /** Accumulates the difference of the energy deposits of the current event in the plus and minus configurations.*/
+  void AddEvent(const Results& thePlusResult, const Results& theMinusResult);
+
+  /** Writes the difference quotients per layer into the given file and prints that of the energy deposit in the absorber.*/
+  void Write(const std::string& fileName, std::ostream& os) const;
+
+private:
+  EParameter                       fParameter;  ///< the perturbed input parameter
+  double                           fStep;       ///< the step h
+  std::vector<Accumulator<double>> fDiff;       ///< difference quotient of the energy deposit per layer per event
+  std::vector<Accumulator<double>> fPlus;       ///< energy deposit per layer per event in the plus configuration
+  std::vector<Accumulator<double>> fMinus;      ///< energy deposit per layer per event in the minus configuration
+  Accumulator<double>              fDiffAbs;    ///< difference quotient of the energy deposit in the absorber per event
+  Accumulator<double>              fPlusAbs;    ///< energy deposit in the absorber per event in the plus configuration
+  Accumulator<double>              fMinusAbs;   ///< energy deposit in the absorber per event in the minus configuration
+};
+
+#endif // FINITEDIFFERENCE_HH
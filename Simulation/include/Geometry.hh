@@ -128,6 +128,8 @@
  * the expected distance to the next boundary of volume B is computed.
  */
 
+#include <vector>
+
 // forward
 class Box;
 
@@ -137,8 +139,12 @@ public:
 
   /** Constructor: sets the default configuration, creates the Box objects for all components.*/
   Geometry();
+  /** Copy constructor: creates its own copies of the Box objects of the components (e.g. one geometry per worker thread).*/
+  Geometry(const Geometry& other);
   /** Destructor: deletes the Box objects that represents the volume of the components.*/
  ~Geometry();
+  /** Assignment is not supported (use the setters to reconfigure a geometry).*/
+  Geometry& operator=(const Geometry&) = delete;
 
   /** Sets the number of layers the entire calorimeter should be built up.
     * @param[in]  nlayers Number of layers (must be > 0) requested (all parameters are recalculated).
@@ -240,6 +246,15 @@ public:
     */
   G4double GetCaloStartXposition() const { return fCaloStartX; }
 
+  /** Provides the material-cuts indices of the volumes of the geometry.
+    *
+    * These are the `Geant4` material-cuts indices (mapped to the `G4HepEm` ones by
+    * `fG4MCIndexToHepEmMCIndex`) the data file needs to provide (see `LoadG4HepEmState()`).
+    *
+    * @return the distinct material-cuts indices used by the volumes (in increasing order).
+    */
+  std::vector<int> GetMaterialIndices() const;
+
 
   /**
     * Locates a point in the geometry and calculates the distance till the next boundary.
@@ -25,7 +25,20 @@ struct InputParameters {
 
   /** CTR with default values: default geometry, primary and event configuirations (see below) with
     * pre-generated data files expected at `../data/hepem_data` relative to the `HepEmShow` executable.*/
-  InputParameters() : fG4HepEmDataFile("../data/hepem_data"), fRunVerbosity(1) {}
+  InputParameters() : fG4HepEmDataFile("../data/hepem_data"), fRunVerbosity(1), fNumThreads(1), fRunMode(BuildRunMode()), fReplaySelection("all"), fPerfCounters(false), fTraceTracks(false), fMetricsInterval(10.0),
+                      fTargetRelError(0.0), fTimeBudget(0.0), fPrecisionDerivatives(false), fBatchSize(100),
+                      fFDStep(0.0), fNumTrackThreads(1) {}
+
+  /** The run mode of this build: "forward"/"reverse" in forward/reverse-mode AD builds and "primal" otherwise.*/
+  static std::string BuildRunMode() {
+    #if defined(CODI_FORWARD)
+      return "forward";
+    #elif defined(CODI_REVERSE)
+      return "reverse";
+    #else
+      return "primal";
+    #endif
+  }
 
 
   /** The geometry related input arguments.*/
@@ -66,6 +79,27 @@ struct InputParameters {
   PrimaryAndEvents fPrimaryAndEvents; ///< the primary partcile and events related configuration
   std::string      fG4HepEmDataFile;  ///< the pre-generated data file (with path)
   int              fRunVerbosity;     ///< level of printout verbosity duing setting up: nothing when < 1.
+  int              fNumThreads;       ///< number of worker threads used for the event processing
+  std::string      fRunMode;          ///< "primal" or the AD mode of this build ("forward"/"reverse"): derivatives are not computed in "primal" runs
+  std::string      fRecordFile;       ///< file to record the seed and cost of each event into (no recording if empty)
+  std::string      fReplayFile;       ///< file of event records to replay, i.e. only these events are simulated (no replay if empty)
+  std::string      fReplaySelection;  ///< the selection of the replayed events: "all", "random:K" or "top:K"
+  bool             fPerfCounters;     ///< measure the hardware performance counters of the event loop (if available)
+  std::string      fTraceFile;        ///< file to write the timeline of the run into (Chrome trace JSON, no timeline if empty)
+  bool             fTraceTracks;      ///< record also each track on the timeline (not only the events)
+  std::string      fRunReportFile;    ///< file to write the (JSON) run report into (no report if empty)
+  std::string      fMetricsFile;      ///< Prometheus textfile to write the live metrics into (no live metrics if empty)
+  double           fMetricsInterval;  ///< time between two snapshots of the live metrics in [s]
+  double           fTargetRelError;   ///< stop when the relative standard error of the selected accumulators is below (not used if <= 0)
+  double           fTimeBudget;       ///< stop when the wall-clock time of the event loop reached this in [s] (not used if <= 0)
+  std::vector<int> fPrecisionLayers;  ///< the layers selected for the target precision (all if empty)
+  bool             fPrecisionDerivatives; ///< the target precision is required for the derivative accumulators (AD builds only)
+  int              fBatchSize;        ///< number of events (of each worker) between two checks of the stopping rule
+  std::string      fFDParameter;      ///< the parameter of the lockstep finite differences: "abs", "gap" or "energy" (no finite differences if empty)
+  double           fFDStep;           ///< the step of the finite differences in [mm] or [MeV] (1 % of the nominal value if <= 0)
+  std::string      fPreset;           ///< the accuracy/speed preset of the data file generated by `HepEmShow-DataGeneration -P` (the `-d` file itself if empty or "default")
+  std::string      fNumaNodes;        ///< the NUMA nodes of the workers: "all" or e.g. "0:1" (with a state replica per node, no placement if empty)
+  int              fNumTrackThreads;  ///< number of worker threads sharing the tracks of each event (events are shared by the `fNumThreads` workers if 1)
   #ifdef CODI_REVERSE
     std::vector<double> barEdep;     ///< Bar values of the energy depositions
   #endif
@@ -89,7 +123,57 @@ void PrintParameters (const struct InputParameters& theParam) {
 
   std::cout << "     --- Additional configuration: " << std::endl;
   std::cout << "         - g4hepem-data-file    : "     << theParam.fG4HepEmDataFile  << std::endl;
+  if (!theParam.fPreset.empty()) {
+    std::cout << "         - preset               : "     << theParam.fPreset           << std::endl;
+  }
+  if (!theParam.fNumaNodes.empty()) {
+    std::cout << "         - numa-nodes           : "     << theParam.fNumaNodes        << std::endl;
+  }
   std::cout << "         - run-verbosity        : "     << theParam.fRunVerbosity     << std::endl;
+  std::cout << "         - number-of-threads    : "     << theParam.fNumThreads       << std::endl;
+  if (theParam.fNumTrackThreads > 1) {
+    std::cout << "         - track-threads        : "     << theParam.fNumTrackThreads  << std::endl;
+  }
+  std::cout << "         - mode                 : "     << theParam.fRunMode          << std::endl;
+  if (!theParam.fRecordFile.empty()) {
+    std::cout << "         - record-events        : "     << theParam.fRecordFile       << std::endl;
+  }
+  if (!theParam.fReplayFile.empty()) {
+    std::cout << "         - replay-events        : "     << theParam.fReplayFile       << std::endl;
+    std::cout << "         - replay-selection     : "     << theParam.fReplaySelection  << std::endl;
+  }
+  std::cout << "         - perf-counters        : "     << (theParam.fPerfCounters ? "yes" : "no") << std::endl;
+  if (!theParam.fTraceFile.empty()) {
+    std::cout << "         - trace-file           : "     << theParam.fTraceFile        << std::endl;
+    std::cout << "         - trace-tracks         : "     << (theParam.fTraceTracks ? "yes" : "no") << std::endl;
+  }
+  if (!theParam.fRunReportFile.empty()) {
+    std::cout << "         - run-report           : "     << theParam.fRunReportFile    << std::endl;
+  }
+  if (!theParam.fMetricsFile.empty()) {
+    std::cout << "         - metrics-file         : "     << theParam.fMetricsFile      << std::endl;
+    std::cout << "         - metrics-interval     : "     << theParam.fMetricsInterval  << " [s]" << std::endl;
+  }
+  if (theParam.fTargetRelError > 0.0 || theParam.fTimeBudget > 0.0) {
+    std::cout << "     --- Stopping rule (max. number of events: " << theParam.fPrimaryAndEvents.fNumEvents << "): " << std::endl;
+    std::cout << "         - target-precision     : "     << theParam.fTargetRelError   << std::endl;
+    std::cout << "         - time-budget          : "     << theParam.fTimeBudget       << " [s]" << std::endl;
+    std::cout << "         - precision-layers     : ";
+    if (theParam.fPrecisionLayers.empty()) {
+      std::cout << "all";
+    }
+    for (std::size_t i = 0; i < theParam.fPrecisionLayers.size(); ++i) {
+      std::cout << (i > 0 ? ":" : "") << theParam.fPrecisionLayers[i];
+    }
+    std::cout << std::endl;
+    std::cout << "         - precision-derivatives: "     << (theParam.fPrecisionDerivatives ? "yes" : "no") << std::endl;
+    std::cout << "         - batch-size           : "     << theParam.fBatchSize        << std::endl;
+  }
+  if (!theParam.fFDParameter.empty()) {
+    std::cout << "     --- Lockstep finite differences: " << std::endl;
+    std::cout << "         - fd-parameter         : "     << theParam.fFDParameter      << std::endl;
+    std::cout << "         - fd-step              : "     << theParam.fFDStep           << std::endl;
+  }
 
 }
 
@@ -108,10 +192,31 @@ static struct option options[] = {
   {"random-seed                                                           - default: 1234"   , required_argument, 0, 's'},
 
   {"g4hepem-data-file     (the pre-generated data file with its path)     - default: ../data/hepem_data" , required_argument, 0, 'd'},
+  {"preset                (data preset: fast, default, precise, ...)      - default: default (the -d file)", required_argument, 0, 'P'},
+  {"numa-nodes            (pin workers to NUMA nodes: all or e.g. 0:1)    - default: no pinning"   , required_argument, 0, 'A'},
   #ifdef CODI_REVERSE
     {"edep-bars             (bar values of edeps, in [MeV] units)           - default:: 0:0:...:0", required_argument, 0, 'b'},
   #endif
   {"run-verbosity         (verbosity of run information: nothing when 0)  - default: 1"      , required_argument, 0, 'v'},
+  {"number-of-threads     (number of worker threads)                      - default: 1"      , required_argument, 0, 'j'},
+  {"track-threads         (threads sharing the tracks of each event)      - default: 1 (events are shared)", required_argument, 0, 'U'},
+  {"mode                  (primal or the AD mode of the build)            - default: AD mode of the build", required_argument, 0, 'm'},
+  {"record-events         (file to record the seed and cost of each event)- default: no recording", required_argument, 0, 'r'},
+  {"replay-events         (file of recorded events to simulate)           - default: no replay"    , required_argument, 0, 'R'},
+  {"replay-selection      (replayed events: all, random:K or top:K)       - default: all"          , required_argument, 0, 'k'},
+  {"perf-counters         (measure the hardware performance counters)     - default: no"           , no_argument      , 0, 'c'},
+  {"trace-file            (file to write the Chrome trace timeline into)  - default: no timeline"  , required_argument, 0, 'T'},
+  {"trace-tracks          (record also the tracks on the timeline)        - default: no"           , no_argument      , 0, 'x'},
+  {"run-report            (file to write the JSON run report into)        - default: no report"    , required_argument, 0, 'J'},
+  {"metrics-file          (Prometheus textfile of the live metrics)       - default: no live metrics", required_argument, 0, 'M'},
+  {"metrics-interval      (time between two metrics snapshots in [s])     - default: 10"           , required_argument, 0, 'I'},
+  {"target-precision      (stop at this rel. std. error of the means)     - default: not used"     , required_argument, 0, 'E'},
+  {"time-budget           (stop after this wall-clock time in [s])        - default: not used"     , required_argument, 0, 'W'},
+  {"precision-layers      (layers for the precision: all or e.g. 0:10-20) - default: all"          , required_argument, 0, 'L'},
+  {"precision-derivatives (precision of the derivatives, AD builds only)  - default: no"           , no_argument      , 0, 'D'},
+  {"batch-size            (events between two checks of the stopping rule)- default: 100"          , required_argument, 0, 'B'},
+  {"fd-parameter          (finite differences w.r.t.: abs, gap or energy) - default: no finite differences", required_argument, 0, 'F'},
+  {"fd-step               (step of the finite differences in [mm]/[MeV])  - default: 1 % of the value", required_argument, 0, 'H'},
   {"help"                                                                                    , no_argument      , 0, 'h'},
   {0, 0, 0, 0}
 };
@@ -140,6 +245,29 @@ static inline std::vector<double> stod_array(const char* arg){
   return ret;
 }
 
+// Parses the layer selection 'all' or 'item1:item2:...:itemN' with items of a single layer 'i' or a range 'i-j'.
+static inline std::vector<int> parseLayers(const char* arg){
+  std::vector<int> ret;
+  std::string arg_s(arg);
+  if (arg_s == "all") {
+    return ret;
+  }
+  arg_s = arg_s + ":";
+  size_t pos = 0;
+  do {
+     int sep = arg_s.find(":",pos);
+     std::string s = arg_s.substr(pos,sep-pos);
+     const size_t dash = s.find("-");
+     const int first = std::stoi(s.substr(0,dash));
+     const int last  = dash == std::string::npos ? first : std::stoi(s.substr(dash+1));
+     for (int i = first; i <= last; ++i) {
+       ret.push_back(i);
+     }
+     pos = sep+1;
+  } while(pos<arg_s.size());
+  return ret;
+}
+
 // In forward-mode AD, allow real-number arguments to consist of two numbers separated by ':'.
 // If existent, the second number specifies the dot value of the input argument.
 static inline G4double parseRealInput(const char* arg){
@@ -164,7 +292,7 @@ static inline G4double parseRealInput(const char* arg){
 void GetOpt(int argc, char *argv[], InputParameters& param) {
   while (true) {
     int c, optidx = 0;
-    c = getopt_long(argc, argv, "hl:a:g:t:p:e:n:s:d:v:b:", options, &optidx);
+    c = getopt_long(argc, argv, "hl:a:g:t:p:e:n:s:d:v:b:j:m:r:R:k:cT:xJ:M:I:E:W:L:DB:F:H:P:A:U:", options, &optidx);
     if (c == -1)
       break;
     switch (c) {
@@ -209,6 +337,18 @@ void GetOpt(int argc, char *argv[], InputParameters& param) {
     case 'v':
        param.fRunVerbosity = std::stoi(optarg);
        break;
+    case 'j':
+       param.fNumThreads = std::stoi(optarg);
+       break;
+    case 'm':
+       param.fRunMode = optarg;
+       if ( !(param.fRunMode=="primal" || param.fRunMode==InputParameters::BuildRunMode()) ) {
+         std::cout << "\n *** Run mode -m: " << optarg << " is not available in this build (primal or "
+                   << InputParameters::BuildRunMode() << ")" << std::endl;
+         Help();
+         exit(-1);
+       }
+       break;
 
     case 'b':
        #ifdef CODI_REVERSE
@@ -218,6 +358,69 @@ void GetOpt(int argc, char *argv[], InputParameters& param) {
        #endif
        break;
 
+    case 'r':
+       param.fRecordFile = optarg;
+       break;
+    case 'R':
+       param.fReplayFile = optarg;
+       break;
+    case 'k':
+       param.fReplaySelection = optarg;
+       break;
+    case 'c':
+       param.fPerfCounters = true;
+       break;
+    case 'T':
+       param.fTraceFile = optarg;
+       break;
+    case 'x':
+       param.fTraceTracks = true;
+       break;
+    case 'J':
+       param.fRunReportFile = optarg;
+       break;
+    case 'M':
+       param.fMetricsFile = optarg;
+       break;
+    case 'I':
+       param.fMetricsInterval = std::stod(optarg);
+       break;
+    case 'E':
+       param.fTargetRelError = std::stod(optarg);
+       break;
+    case 'W':
+       param.fTimeBudget = std::stod(optarg);
+       break;
+    case 'L':
+       param.fPrecisionLayers = parseLayers(optarg);
+       break;
+    case 'D':
+       param.fPrecisionDerivatives = true;
+       break;
+    case 'B':
+       param.fBatchSize = std::stoi(optarg);
+       break;
+    case 'F':
+       param.fFDParameter = optarg;
+       if ( !(param.fFDParameter=="abs" || param.fFDParameter=="gap" || param.fFDParameter=="energy") ) {
+         std::cout << "\n *** Unknown finite-difference parameter -F: " << optarg << " (abs, gap or energy)" << std::endl;
+         Help();
+         exit(-1);
+       }
+       break;
+    case 'H':
+       param.fFDStep = std::stod(optarg);
+       break;
+    case 'P':
+       param.fPreset = optarg;
+       break;
+    case 'A':
+       param.fNumaNodes = optarg;
+       break;
+    case 'U':
+       param.fNumTrackThreads = std::stoi(optarg);
+       break;
+
     case 'h':
        Help();
        exit(-1);
@@ -235,10 +438,110 @@ void GetOpt(int argc, char *argv[], InputParameters& param) {
      Help();
      exit(-1);
    }
+   // number of worker threads must be >= 1
+   if (param.fNumThreads < 1 ) {
+     printf("\n *** Number of worker threads must be >= 1! \n");
+     Help();
+     exit(-1);
+   }
+   // time between two snapshots of the live metrics must be > 0
+   if (param.fMetricsInterval <= 0.0) {
+     printf("\n *** Time between two live metrics snapshots must be > 0! \n");
+     Help();
+     exit(-1);
+   }
+   // the stopping rule: batches of at least one event, not with recorded or replayed events and
+   // the precision of the derivatives only if they are computed
+   if (param.fTargetRelError > 0.0 || param.fTimeBudget > 0.0) {
+     if (param.fBatchSize < 1) {
+       printf("\n *** Batch size of the stopping rule must be >= 1! \n");
+       Help();
+       exit(-1);
+     }
+     if (!param.fRecordFile.empty() || !param.fReplayFile.empty()) {
+       printf("\n *** The stopping rule (-E, -W) cannot be used when recording (-r) or replaying (-R) events! \n");
+       Help();
+       exit(-1);
+     }
+     if (param.fPrecisionDerivatives && param.fRunMode == "primal") {
+       printf("\n *** The precision of the derivatives (-D) requires an AD build (not in primal mode)! \n");
+       Help();
+       exit(-1);
+     }
+   }
+   // the lockstep finite differences: single worker, not with the stopping rule, the live metrics or
+   // recorded/replayed events, and the perturbed parameter must stay non-negative (energy: positive)
+   if (!param.fFDParameter.empty()) {
+     if (param.fNumThreads > 1 || param.fTargetRelError > 0.0 || param.fTimeBudget > 0.0 || !param.fMetricsFile.empty()
+         || !param.fRecordFile.empty() || !param.fReplayFile.empty()) {
+       printf("\n *** The finite differences (-F) cannot be used with more than one thread (-j), the stopping rule (-E, -W),"
+              " the live metrics (-M) or when recording (-r) or replaying (-R) events! \n");
+       Help();
+       exit(-1);
+     }
+     const double value = GET_VALUE(param.fFDParameter == "abs" ? param.fGeometry.fThicknessAbsorber
+                                    : (param.fFDParameter == "gap" ? param.fGeometry.fThicknessGap : param.fPrimaryAndEvents.fParticleEnergy));
+     if (param.fFDStep <= 0.0) {
+       param.fFDStep = 0.01*value;
+     }
+     if (!(param.fFDStep > 0.0) || value - param.fFDStep < 0.0 || (param.fFDParameter == "energy" && value - param.fFDStep <= 0.0)) {
+       printf("\n *** The finite-difference step (-H) must be > 0 and smaller than the nominal value of the parameter! \n");
+       Help();
+       exit(-1);
+     }
+   }
+   // the NUMA placement is for the workers of the (multi-threaded) event loop
+   if (!param.fNumaNodes.empty() && (!param.fRecordFile.empty() || !param.fReplayFile.empty() || !param.fFDParameter.empty())) {
+     printf("\n *** The NUMA placement (-A) cannot be used when recording (-r) or replaying (-R) events or with the finite differences (-F)! \n");
+     Help();
+     exit(-1);
+   }
+   // the tracks of the events are shared by the workers of the event-by-event loop only: not with the event
+   // level workers, the NUMA placement, the finite differences, recorded/replayed events or the hardware counters
+   // (per thread), and the tape of an event cannot be shared (reverse-mode AD builds: only in primal runs)
+   if (param.fNumTrackThreads < 1) {
+     printf("\n *** Number of track worker threads must be >= 1! \n");
+     Help();
+     exit(-1);
+   }
+   if (param.fNumTrackThreads > 1) {
+     if (param.fNumThreads > 1 || !param.fNumaNodes.empty() || !param.fFDParameter.empty() || !param.fRecordFile.empty()
+         || !param.fReplayFile.empty() || param.fPerfCounters) {
+       printf("\n *** The track worker threads (-U) cannot be used with more than one event worker thread (-j), the NUMA placement (-A),"
+              " the finite differences (-F), the hardware counters (-c) or when recording (-r) or replaying (-R) events! \n");
+       Help();
+       exit(-1);
+     }
+     #ifdef CODI_REVERSE
+       if (param.fRunMode != "primal") {
+         printf("\n *** The track worker threads (-U) cannot share the tape of an event: only in primal mode (-m primal) of reverse-mode AD builds! \n");
+         Help();
+         exit(-1);
+       }
+     #endif
+   }
+   // events can be either recorded or replayed
+   if (!param.fRecordFile.empty() && !param.fReplayFile.empty()) {
+     printf("\n *** Events can be either recorded (-r) or replayed (-R) but not both! \n");
+     Help();
+     exit(-1);
+   }
+   // no dot values in primal runs (might have been given before the run mode)
+   #ifdef CODI_FORWARD
+     if (param.fRunMode == "primal") {
+       SET_DOTVALUE(param.fGeometry.fThicknessAbsorber, 0.0);
+       SET_DOTVALUE(param.fGeometry.fThicknessGap, 0.0);
+       SET_DOTVALUE(param.fPrimaryAndEvents.fParticleEnergy, 0.0);
+     }
+   #endif
    // check if the data file was given with/without extension
    if (param.fG4HepEmDataFile.find(".json")==std::string::npos) {
      param.fG4HepEmDataFile += ".json";
    }
+   // the data file of a preset (other than the default) is `<data file>_<preset>.json`
+   if (!param.fPreset.empty() && param.fPreset != "default") {
+     param.fG4HepEmDataFile.insert(param.fG4HepEmDataFile.rfind(".json"), "_" + param.fPreset);
+   }
    // print parameters if the verbosity > 0
    if (param.fRunVerbosity > 0) {
      PrintParameters(param);
@@ -0,0 +1,68 @@
+#ifndef LIVEMETRICS_HH
+#define LIVEMETRICS_HH
+
+/**
+ * @file    LiveMetrics.hh
+ * @class   LiveMetrics
+ *
+ * @brief Live progress and metrics of long runs: Prometheus textfile snapshots and intermediate results on `SIGUSR1`.
+ *
+ * When enabled (`-M` input argument), the event loops publish the results of
+ * each event (number of steps and energy deposit per layer) into the slot of
+ * their thread by using only relaxed atomic stores (each slot is written only by
+ * its thread), i.e. the event processing never waits for the monitoring. A
+ * background thread periodically (`-I` input argument, 10 s by default) sums
+ * the slots and writes a snapshot in the Prometheus textfile format (e.g. for
+ * the textfile collector of the node exporter) with:
+ * - `hepemshow_events_done`, `hepemshow_events_total`, `hepemshow_events_per_second`
+ *   and `hepemshow_eta_seconds`
+ * - `hepemshow_steps_per_second{particle="..."}`
+ * - `hepemshow_edep_layer_mean_mev{layer="..."}` and `hepemshow_edep_layer_rel_error{layer="..."}`:
+ *   the current mean energy deposit per layer (per event) and its relative
+ *   (statistical) error
+ *
+ * The snapshot is written to a temporary file that is then renamed, so readers
+ * never see a partial snapshot. When the process receives `SIGUSR1`, the
+ * background thread prints the same intermediate results (within 0.1 s).
+ *
+ * @note The slots are read while they are written, so the layer sums of a snapshot
+ * might already contain (a part of) the event that is being published. This is
+ * irrelevant for monitoring but the snapshots must not be used as final results.
+ */
+
+#include <string>
+
+struct Results;
+
+class LiveMetrics {
+
+public:
+
+  /** Starts the background thread that writes a snapshot into the given file in every `period` [s] (installs the `SIGUSR1` handler).
+   *
+   * @param fileName the Prometheus textfile to write the snapshots into
+   * @param period the time between two snapshots in [s]
+   * @param numEventsTotal the number of events that will be simulated (for the ETA)
+   * @param numLayers the number of layers of the calorimeter
+   * @param numThreads the number of threads that publish events (one slot each)
+   */
+  static void Start(const std::string& fileName, double period, int numEventsTotal, int numLayers, int numThreads);
+
+  /** Stops the background thread (after writing the final snapshot) and restores the previous `SIGUSR1` handler.*/
+  static void Stop();
+
+  /** Sets the number of events that will be simulated (e.g. when only a selection of events is replayed).*/
+  static void SetNumEventsTotal(int numEventsTotal);
+
+  /** If the live metrics are enabled.*/
+  static inline bool IsEnabled() { return gEnabled; }
+
+  /** Publishes the results of the event that has just been completed by the calling thread (never blocks).*/
+  static void PublishEvent(const Results& res);
+
+private:
+
+  static bool gEnabled;  ///< if the live metrics are enabled (set before the event loop starts)
+};
+
+#endif // LIVEMETRICS_HH
@@ -0,0 +1,95 @@
+#include "ad_type.h"
+
+
+#ifndef MULTILEVELMC_HH
+#define MULTILEVELMC_HH
+
+/**
+ * @file    MultiLevelMC.hh
+ * @class   MultiLevelMC
+ *
+ * @brief Multilevel Monte Carlo estimator of the mean energy deposit per layer over fidelity levels.
+ *
+ * The levels \f$ l = 0, \dots, L \f$ are simulations of increasing fidelity
+ * and cost, e.g. with `G4HepEm` data of decreasing secondary production
+ * thresholds. The mean energy deposit \f$ \langle E^L_i \rangle \f$ of the
+ * finest level in layer \f$ i \f$ is estimated by the telescoping sum
+ * \f[
+ *   \langle E^L_i \rangle = \langle E^0_i \rangle + \sum_{l=1}^{L} \langle E^l_i - E^{l-1}_i \rangle
+ * \f]
+ * in which the events of level \f$ l > 0 \f$ are simulated both with the fine
+ * (\f$ l \f$) and coarse (\f$ l-1 \f$) fidelity from the same seed (see
+ * `EventLoop::ProcessEventsCoupled()`), so the variance \f$ V_l \f$ of the
+ * differences is small and only a few of the expensive events are needed.
+ *
+ * The numbers of events of the levels are allocated optimally
+ * \f$ N_l = \lceil \epsilon^{-2} \sqrt{V_l/C_l} \sum_k \sqrt{V_k C_k} \rceil \f$
+ * for the target variance \f$ \epsilon^2 \f$ of the estimates (summed over the
+ * layers) from the measured per-event cost \f$ C_l \f$ and variance \f$ V_l \f$
+ * (summed over the layers) of each level.
+ */
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include "accumulator.hh"
+
+struct Results;
+
+class MultiLevelMC {
+
+public:
+
+  /** CTR.
+   *
+   * @param numLevels number of fidelity levels (coarsest first)
+   * @param numLayers number of layers of the calorimeter
+   */
+  MultiLevelMC(int numLevels, int numLayers);
+
+  /** Number of levels.*/
+  int  GetNumLevels() const { return fLevels.size(); }
+
+  /** Accumulates the current event of the given level: the fine results, the coarse results (`nullptr` on level 0) and their cost in [s].*/
+  void AddEvent(int level, const Results& theFineResult, const Results* theCoarseResult, double fineTime, double coarseTime);
+
+  /** Number of events simulated on the given level.*/
+  int    GetNumEvents(int level) const;
+
+  /** Variance per event of the differences of the given level (summed over the layers).*/
+  double GetVariance(int level) const;
+
+  /** Mean cost per event of the given level (the fine and the coarse simulation) in [s].*/
+  double GetCost(int level) const;
+
+  /** Target variance of the estimates (summed over the layers) that corresponds to the given relative standard error (of the current estimates).*/
+  double TargetVariance(double relError) const;
+
+  /** The optimal number of events of each level to reach the given variance of the estimates (summed over the layers).*/
+  std::vector<int> OptimalNumEvents(double targetVariance) const;
+
+  /** Writes the estimates of the mean energy deposit per layer and their standard errors into the given file and prints the level statistics.
+   *
+   * @param fileName the file of the estimates (one line per layer)
+   * @param os the stream of the level statistics and the estimated cost saving (compared to finest-level-only events)
+   * @param targetVariance the target variance of the estimates (for the cost comparison)
+   */
+  void Write(const std::string& fileName, std::ostream& os, double targetVariance) const;
+
+private:
+  /** Accumulators of one level.*/
+  struct Level {
+    std::vector<Accumulator<double>> fDiff;      ///< difference of the fine and coarse energy deposit per layer per event (the fine one on level 0)
+    std::vector<Accumulator<double>> fFine;      ///< fine energy deposit per layer per event
+    Accumulator<double>              fCost;      ///< cost of the fine and coarse simulation per event in [s]
+    Accumulator<double>              fFineCost;  ///< cost of the fine simulation per event in [s]
+  };
+
+  /** Estimate of the mean and of its variance in the given layer.*/
+  void Estimate(int layer, double& mean, double& variance) const;
+
+private:
+  std::vector<Level> fLevels;  ///< the levels (coarsest first)
+};
+
+#endif // MULTILEVELMC_HH
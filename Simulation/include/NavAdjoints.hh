@@ -0,0 +1,55 @@
+#include "ad_type.h"
+
+
+#ifndef NAVADJOINTS_HH
+#define NAVADJOINTS_HH
+
+/**
+ * @file    NavAdjoints.hh
+ *
+ * @brief Hand-written adjoints of the navigation kernels for reverse-mode AD builds.
+ *
+ * `Box::DistanceToOut()` (both) and the coordinate transformations of
+ * `Geometry::CalculateDistanceToOut()` are called at each step of each track.
+ * Taping them statement by statement (including the `copysign`, `min` and `abs`
+ * operations) would record several statements with many arguments per call while
+ * their results depend only on a few active inputs (position, direction and the
+ * half lengths/thicknesses) through simple analytic expressions.
+ *
+ * Therefore, in reverse-mode AD builds (when `HEPEMSHOW_NAV_ADJOINTS` is defined,
+ * see the `HepEmShow_NAV_ADJOINTS` CMake option), these kernels compute their
+ * result as primal (`double`) value and record it on the tape as a single
+ * statement with the analytic partial derivatives with respect to its (active)
+ * arguments by using `SetWithPartials()`.
+ */
+
+#if defined(CODI_REVERSE) && defined(HEPEMSHOW_NAV_ADJOINTS)
+  #define HEPEMSHOW_USE_NAV_ADJOINTS
+#endif
+
+#ifdef HEPEMSHOW_USE_NAV_ADJOINTS
+
+/** Sets `lhs` to the given primal value as the result of a single statement with the given arguments and partial derivatives.
+  *
+  * @param[out] lhs       the active result
+  * @param[in]  primal    the primal value of the result
+  * @param[in]  args      pointers to the active arguments of the statement
+  * @param[in]  jacobians the partial derivatives of the result with respect to the corresponding arguments
+  */
+template<int N>
+inline void SetWithPartials(G4double& lhs, double primal, const G4double* const (&args)[N], const double (&jacobians)[N]) {
+  if (!G4double::getTape().isActive()) {
+    lhs = primal;
+    return;
+  }
+  codi::StatementPushHelper<G4double> ph;
+  ph.startPushStatement();
+  for (int i = 0; i < N; ++i) {
+    ph.pushArgument(*args[i], jacobians[i]);
+  }
+  ph.endPushStatement(lhs, primal);
+}
+
+#endif // HEPEMSHOW_USE_NAV_ADJOINTS
+
+#endif // NAVADJOINTS_HH
@@ -0,0 +1,73 @@
+#ifndef NUMAPLACEMENT_HH
+#define NUMAPLACEMENT_HH
+
+/**
+ * @file    NumaPlacement.hh
+ * @class   NumaPlacement
+ *
+ * @brief NUMA-aware placement of the worker threads with per-node replicas of the `G4HepEm` state.
+ *
+ * On multi-socket machines, the `G4HepEm` tables loaded by the main thread are
+ * in the memory of a single NUMA node, so the workers on the other nodes read
+ * all their tables through the inter-socket link. When the placement is
+ * required (`-A` input argument with the selected nodes), the NUMA topology is
+ * read from `/sys/devices/system/node` and:
+ * - the worker threads are distributed round-robin over the selected nodes and
+ *   each is pinned to the CPUs of its node
+ * - the first worker of each node loads a replica of the (read-only) `G4HepEm`
+ *   state by the `fReplicaLoader` after pinning itself, so the replica is
+ *   first-touched, i.e. allocated, in the memory of that node, while the other
+ *   workers of the node wait for it and then use the same local replica
+ *
+ * Selecting a single node (e.g. `-A 0`) or all the nodes of the machine makes
+ * possible to measure the scaling on one versus more sockets. When the topology
+ * is not available (e.g. not Linux), the machine is a single node with all CPUs.
+ */
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <iostream>
+
+struct G4HepEmState;
+
+class NumaPlacement {
+
+public:
+
+  /** CTR: reads the NUMA topology of the machine (all its nodes are selected).*/
+  NumaPlacement();
+
+  /** Selects the nodes used by the workers: `all` or a list of node IDs such as `0:1` (returns false if unknown).*/
+  bool SelectNodes(const std::string& nodes);
+
+  /** Number of the selected nodes.*/
+  int  GetNumNodes() const { return fSelected.size(); }
+
+  /** Index of the selected node of the given worker (round-robin).*/
+  int  GetNodeOfWorker(int workerID) const { return workerID % GetNumNodes(); }
+
+  /** ID of the given selected node.*/
+  int  GetNodeID(int node) const { return fNodes[fSelected[node]].fID; }
+
+  /** Pins the calling thread to the CPUs of the given selected node (returns false if not possible).*/
+  bool Pin(int node) const;
+
+  /** Prints the selected nodes with their CPUs.*/
+  void Print(std::ostream& os) const;
+
+  /** Loads a replica of the `G4HepEm` state (called by the first worker of each node): the workers share the input state if not set.*/
+  std::function<G4HepEmState*()> fReplicaLoader;
+
+private:
+  /** A NUMA node of the machine.*/
+  struct Node {
+    int              fID;    ///< the ID of the node
+    std::vector<int> fCPUs;  ///< the CPUs of the node
+  };
+
+  std::vector<Node> fNodes;     ///< the nodes of the machine
+  std::vector<int>  fSelected;  ///< the indices of the selected nodes
+};
+
+#endif // NUMAPLACEMENT_HH
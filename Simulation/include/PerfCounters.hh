@@ -0,0 +1,79 @@
+#ifndef PERFCOUNTERS_HH
+#define PERFCOUNTERS_HH
+
+/**
+ * @file    PerfCounters.hh
+ * @class   PerfCounters
+ *
+ * @brief Hardware performance counters (Linux `perf_event_open`) of the calling thread.
+ *
+ * The cycles, instructions, L1 data cache read misses, last level cache (LLC)
+ * misses and branch misses of the calling thread (user space only) are counted
+ * when measuring the hardware performance counters is required (`-c` input
+ * argument). The `EventLoop` measures them for the entire event loop and for its
+ * main phases:
+ * - `transport`: simulation of all tracks of the events (i.e. the steppers)
+ * - `end of event`: end of event action (including the reverse sweep in
+ *   reverse-mode AD builds)
+ *
+ * The counts of each thread are accumulated in the `PerfCounterData` of its
+ * `Results` that are merged over the threads and printed by `WriteResults()`
+ * together with the instructions per cycle (IPC) and the miss rates.
+ *
+ * Each counter is opened individually, so the available counters are measured
+ * even if some others are not supported. When `perf_event_open` is not allowed
+ * (e.g. in containers or with `perf_event_paranoid > 2`) or not available (not
+ * Linux), all counters are reported as not available and the simulation runs as
+ * without measuring them. When the kernel multiplexes the counters, the counts
+ * are scaled by the ratio of the enabled and running times.
+ */
+
+#include <cstdint>
+#include <iostream>
+
+
+/** The accumulated counts of the hardware performance counters per phase.*/
+struct PerfCounterData {
+  /** The measured counters.*/
+  enum ECounter { kCycles = 0, kInstructions, kL1DMisses, kLLCMisses, kBranchMisses, kNumCounters };
+  /** The measured phases.*/
+  enum EPhase { kEventLoop = 0, kTransport, kEndOfEvent, kNumPhases };
+
+  std::uint64_t fCounts[kNumPhases][kNumCounters] = {};  ///< accumulated counts per phase and counter
+  bool          fAvailable[kNumCounters] = {};           ///< if the counter could be measured (at least in one thread)
+
+  /** Adds the counts of the other (e.g. of an other thread) to this.*/
+  void Merge(const PerfCounterData& other);
+
+  /** Prints the counts per phase with the IPC and miss rates (not available counters are indicated).*/
+  void Print(std::ostream& os) const;
+};
+
+
+class PerfCounters {
+
+public:
+
+  /** Opens the counters of the calling thread (the counters that cannot be opened are not available).*/
+  PerfCounters();
+
+  /** Closes the counters.*/
+ ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  /** If at least one of the counters is available.*/
+  bool IsAvailable() const;
+
+  /** Reads the current (scaled) values of the counters (zero for the not available counters).*/
+  void Read(std::uint64_t* values) const;
+
+  /** Adds the counts since the given `start` values (obtained by `Read`) to the given phase of the data.*/
+  void Accumulate(PerfCounterData& data, int phase, const std::uint64_t* start) const;
+
+private:
+  int fFD[PerfCounterData::kNumCounters];  ///< file descriptors of the counters (-1 if not available)
+};
+
+#endif // PERFCOUNTERS_HH
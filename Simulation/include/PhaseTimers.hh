@@ -0,0 +1,159 @@
+#ifndef PHASETIMERS_HH
+#define PHASETIMERS_HH
+
+/**
+ * @file    PhaseTimers.hh
+ * @struct  PhaseTimers
+ *
+ * @brief Optional, low overhead timers and counters of the phases of the simulation.
+ *
+ * The `EventLoop` and the `SteppingLoop` are instrumented with the
+ * `HEPEMSHOW_PHASE_BEGIN(phase)`/`HEPEMSHOW_PHASE_END(phase)` macros (and
+ * `HEPEMSHOW_PHASE_SCOPE(phase)` for entire scopes) that accumulate the elapsed
+ * time stamp counter (TSC) ticks and the number of calls of each phase (e.g.
+ * navigation, `HowFar`, `Perform`, MSC displacement, etc.) into a thread local
+ * `PhaseTimers` object. This is collected into the `Results` of the thread at
+ * the end of the event loop (`CollectPhaseTimers`), merged over the threads
+ * and printed by `WriteResults()`.
+ *
+ * The timers are compiled only when `HEPEMSHOW_PHASE_TIMERS` is defined (CMake
+ * option `-DHepEmShow_PHASE_TIMERS=ON`). Otherwise, the macros are empty, so
+ * the timers do not cost anything. The same phase markers are used by the
+ * allocation tracking (see `AllocTracker.hh`).
+ *
+ * @note The time stamp counter is read by `rdtsc` (without serialisation) on x86
+ * while `std::chrono::steady_clock` [ns] is used on other architectures.
+ */
+
+/** The timed phases of the simulation (the event contains all the others).*/
+enum EPhase {
+  kPhaseEvent = 0,           ///< entire event (`EventLoop::ProcessOneEvent`)
+  kPhaseEventBegin,          ///< begin of event action and primary generation
+  kPhaseTrackStack,          ///< popping the next track from the stack and begin of tracking action
+  kPhaseEventEnd,            ///< end of event action (including the reverse sweep in reverse-mode AD)
+  kPhaseNavigation,          ///< `Geometry::CalculateDistanceToOut` (locate and distance to boundary)
+  kPhaseSafety,              ///< pre-step point safety (`Box::DistanceToOut`)
+  kPhaseHowFar,              ///< physics step limit (`G4HepEm{Gamma,Electron}Manager::HowFar`)
+  kPhasePerform,             ///< physics interactions (`G4HepEm{Gamma,Electron}Manager::Perform`)
+  kPhaseMSCDisplacement,     ///< MSC lateral displacement handling (including the post-step safety)
+  kPhaseStackSecondaries,    ///< `SteppingLoop::StackSecondaries`
+  kPhaseSteppingAction,      ///< `SteppingLoop::SteppingAction` scoring
+  kNumPhases
+};
+
+/** Name of the given phase (indented if it is part of the event).*/
+inline const char* PhaseName(int phase) {
+  static const char* names[kNumPhases] = {
+    "event", "  begin of event", "  track stack", "  end of event", "  navigation", "  safety",
+    "  HowFar", "  Perform", "  MSC displacement", "  StackSecondaries", "  SteppingAction" };
+  return (phase > -1 && phase < kNumPhases) ? names[phase] : "none";
+}
+
+
+#ifdef HEPEMSHOW_PHASE_TIMERS
+
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <x86intrin.h>
+#else
+  #include <chrono>
+#endif
+
+struct PhaseTimers {
+  std::uint64_t fTicks[kNumPhases] = {};  ///< accumulated time stamp counter ticks per phase
+  std::uint64_t fCalls[kNumPhases] = {};  ///< number of calls per phase
+
+  /** Current value of the time stamp counter.*/
+  static inline std::uint64_t Now() {
+    #if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+    #else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    #endif
+  }
+
+  /** The phase timers of the calling thread.*/
+  static inline PhaseTimers& ThreadLocal() {
+    static thread_local PhaseTimers theTimers;
+    return theTimers;
+  }
+
+  /** Adds the ticks elapsed since `start` to the given phase of the calling thread.*/
+  static inline void Add(EPhase phase, std::uint64_t start) {
+    PhaseTimers& t = ThreadLocal();
+    t.fTicks[phase] += Now() - start;
+    t.fCalls[phase] += 1;
+  }
+
+  /** Adds the timers of the other (e.g. of an other thread) to this.*/
+  void Merge(const PhaseTimers& other) {
+    for (int i = 0; i < kNumPhases; ++i) {
+      fTicks[i] += other.fTicks[i];
+      fCalls[i] += other.fCalls[i];
+    }
+  }
+
+  /** Prints the ticks per phase (also relative to the entire event) and per call.*/
+  void Print(std::ostream& os) const {
+    const double total = fTicks[kPhaseEvent] > 0 ? static_cast<double>(fTicks[kPhaseEvent]) : 1.0;
+    std::uint64_t sum = 0;
+    for (int i = 1; i < kNumPhases; ++i) sum += fTicks[i];
+    os << " --- Phase timers (ticks of the time stamp counter) ------------ " << std::endl;
+    os << std::setprecision(4) << std::fixed
+       << "  " << std::left << std::setw(20) << "phase" << std::right
+       << std::setw(12) << "Mticks" << std::setw(9) << "%" << std::setw(14) << "calls" << std::setw(12) << "ticks/call" << std::endl;
+    for (int i = 0; i < kNumPhases; ++i) {
+      os << "  " << std::left << std::setw(20) << PhaseName(i) << std::right
+         << std::setw(12) << 1.0E-6*fTicks[i] << std::setw(9) << std::setprecision(2) << 100.0*fTicks[i]/total
+         << std::setw(14) << fCalls[i] << std::setw(12) << std::setprecision(1) << (fCalls[i] > 0 ? double(fTicks[i])/fCalls[i] : 0.0)
+         << std::setprecision(4) << std::endl;
+    }
+    const double other = fTicks[kPhaseEvent] > sum ? double(fTicks[kPhaseEvent] - sum) : 0.0;
+    os << "  " << std::left << std::setw(20) << "  other" << std::right
+       << std::setw(12) << 1.0E-6*other << std::setw(9) << std::setprecision(2) << 100.0*other/total << std::endl;
+    os << std::defaultfloat << std::setprecision(6);
+    os << " ------------------------------------------------------------\n";
+  }
+};
+
+/** Adds the timers of the calling thread to the given ones and resets them.*/
+inline void CollectPhaseTimers(PhaseTimers& to) {
+  to.Merge(PhaseTimers::ThreadLocal());
+  PhaseTimers::ThreadLocal() = PhaseTimers();
+}
+
+/** Times the enclosing scope as the given phase.*/
+class ScopedPhaseTimer {
+public:
+  explicit ScopedPhaseTimer(EPhase phase) : fPhase(phase), fStart(PhaseTimers::Now()) {}
+ ~ScopedPhaseTimer() { PhaseTimers::Add(fPhase, fStart); }
+private:
+  EPhase        fPhase;
+  std::uint64_t fStart;
+};
+
+#define HEPEMSHOW_TIMER_BEGIN_(phase)  const std::uint64_t phaseStart_##phase = PhaseTimers::Now()
+#define HEPEMSHOW_TIMER_END_(phase)    PhaseTimers::Add(phase, phaseStart_##phase)
+#define HEPEMSHOW_TIMER_SCOPE_(phase)  ScopedPhaseTimer phaseScope_##phase(phase)
+
+#else
+
+#define HEPEMSHOW_TIMER_BEGIN_(phase)
+#define HEPEMSHOW_TIMER_END_(phase)
+#define HEPEMSHOW_TIMER_SCOPE_(phase)
+
+#endif // HEPEMSHOW_PHASE_TIMERS
+
+
+// The phase markers drive all the compiled phase instruments: the timers and
+// the allocation tracking (see `AllocTracker.hh`). They are empty if none.
+#include "AllocTracker.hh"
+
+#define HEPEMSHOW_PHASE_BEGIN(phase)  HEPEMSHOW_ALLOC_BEGIN_(phase); HEPEMSHOW_TIMER_BEGIN_(phase)
+#define HEPEMSHOW_PHASE_END(phase)    HEPEMSHOW_TIMER_END_(phase); HEPEMSHOW_ALLOC_END_(phase)
+#define HEPEMSHOW_PHASE_SCOPE(phase)  HEPEMSHOW_ALLOC_SCOPE_(phase); HEPEMSHOW_TIMER_SCOPE_(phase)
+
+#endif // PHASETIMERS_HH
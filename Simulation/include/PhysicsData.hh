@@ -0,0 +1,41 @@
+#ifndef PHYSICSDATA_HH
+#define PHYSICSDATA_HH
+
+/**
+ * @file    PhysicsData.hh
+ *
+ * @brief Loads the `G4HepEm` data file for the material-cuts couples used by the geometry.
+ *
+ * A data file generated by `HepEmShow-DataGeneration` (e.g. with a larger list
+ * of materials shared by many detector variants) may contain more material-cuts
+ * couples than the ones referenced by the volumes of the `Geometry` (see
+ * `Geometry::GetMaterialIndices()`). `LoadG4HepEmState()` loads the data file
+ * and checks that each material-cuts index used by the geometry is mapped to a
+ * `G4HepEm` material-cuts couple (through `fG4MCIndexToHepEmMCIndex`), so a
+ * data file that does not match the geometry is reported at start-up instead
+ * of reading outside of the tables during the simulation. The number of the
+ * couples used and available as well as the load time and resident memory are
+ * printed when the verbosity is > 0.
+ *
+ * @note The `G4HepEm` tables are materialised for all the couples of the file
+ * (the `G4HepEm` JSON loader builds the complete state): a smaller start-up time
+ * and memory requires a data file generated for the materials of the geometry
+ * only (`-m` input argument of `HepEmShow-DataGeneration`).
+ */
+
+#include <string>
+#include <vector>
+
+struct G4HepEmState;
+
+/**
+  * Loads the `G4HepEm` state from the given data file for the given material-cuts indices.
+  *
+  * @param[in] fileName        The `G4HepEm` data file (with its path and extension).
+  * @param[in] materialIndices The `Geant4` material-cuts indices used by the geometry.
+  * @param[in] verbose         Printing the load statistics when the verbosity level is higher than zero.
+  * @return the loaded state or `nullptr` if the file cannot be loaded or does not provide all used couples.
+  */
+G4HepEmState* LoadG4HepEmState(const std::string& fileName, const std::vector<int>& materialIndices, int verbose=0);
+
+#endif // PHYSICSDATA_HH
@@ -0,0 +1,38 @@
+#ifndef RESOURCEUSAGE_HH
+#define RESOURCEUSAGE_HH
+
+/**
+ * @file    ResourceUsage.hh
+ *
+ * @brief Auxiliary functions to obtain the resource usage (memory, CPU time) of the process.
+ *
+ * Used when reporting the performance of a run (e.g. in the benchmarks).
+ */
+
+// NOTE: this is Unix specific!
+#include <sys/resource.h>
+#include <sys/time.h>
+
+/** Peak resident set size of the process in [MB] units.*/
+inline double GetPeakRSSMB() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  // `ru_maxrss` is given in [kB] units on Linux
+  return ru.ru_maxrss/1024.0;
+}
+
+/** CPU time (user + system) consumed by the process (all threads) so far in [s] units.*/
+inline double GetCPUTime() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) + 1.0E-6*(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+/** Wall-clock time stamp in [s] units (to measure elapsed times).*/
+inline double GetWallTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1.0E-6*tv.tv_usec;
+}
+
+#endif // RESOURCEUSAGE_HH
@@ -39,7 +39,11 @@
 
 #include "Hist.hh"
 #include <vector>
+#include <string>
 #include "accumulator.hh"
+#include "PhaseTimers.hh"
+#include "StepStatistics.hh"
+#include "PerfCounters.hh"
 
 /**
  * Data that needs to be accumulated during one `event` (the scope is one event):
@@ -77,7 +81,23 @@ struct Results {
     std::vector<double> barEdep; ///< Bar values of the edeps, to be set in the beginning.
     Accumulator<double> barThicknessAbsorber, barThicknessGap, barParticleEnergy; ///< Accumulate the bar values of the thicknesses and energy.
     G4double pThicknessAbsorber, pThicknessGap, pParticleEnergy; ///< Copies of the thickness and energy variables used by the simulation, used as AD inputs.
+    Accumulator<double> fTapeBytesPerEvent;   ///< used tape memory per event in [byte]
+    Accumulator<double> fReverseTimePerEvent; ///< time of the reverse sweep (tape evaluation) per event in [s]
   #endif
+  bool            fMeasurePerfCounters{false}; ///< measure the hardware performance counters (`-c` input argument)
+  PerfCounterData fPerfCounterData;            ///< the hardware performance counters per phase (see `PerfCounters`)
+  #ifdef HEPEMSHOW_PHASE_TIMERS
+    PhaseTimers fPhaseTimers;               ///< ticks and calls of the phases of the simulation (see `PhaseTimers`)
+  #endif
+  #ifdef HEPEMSHOW_STEP_STATISTICS
+    StepStatistics fStepStatistics;         ///< steps by particle, material, energy and limiter (see `StepStatistics`)
+  #endif
+  #ifdef HEPEMSHOW_ALLOC_TRACKING
+    AllocStatistics fAllocStatistics;       ///< heap allocations per phase and per event (see `AllocTracker`)
+  #endif
+  int  fPeakTrackStackDepth{ 0 };    ///< maximum number of tracks in the `TrackStack` (of any worker) at the same time
+  bool fComputeDerivatives { true }; ///< AD builds only: derivatives are computed (false in primal runs, i.e. no taping and no derivative output)
+  std::string fOutputDir   { "" };   ///< directory of the output files written by `WriteResults` (the working directory if empty)
   Hist fGammaTrackLenghtPerLayer;  ///< mean number of \f$\gamma\f$ steps per-layer histogram
   Hist fElPosTrackLenghtPerLayer;  ///< mean number of \f$e^-/e^+\f$ steps per-layer histogram
   //
@@ -100,10 +120,23 @@ struct Results {
   ResultsPerEvent fPerEventRes;    ///< data structure to accumulate results during a single event
 };
 
+/** Initialises the results for a calorimeter with the given number of layers.
+ *
+ * Sets the properties of the per-layer histograms (their file names and bins), the size of the per-layer
+ * accumulators and (in reverse-mode AD builds) the bar values of the edeps (to zero). The output files are
+ * written into the given (existing) directory or into the working directory if it's empty.*/
+void InitResults(struct Results& res, int numLayers, const std::string& outputDir = "");
+
 /** Writes the final results of the simulation.
  *
  * Writes the 3 histrograms (mean energy deposit, \f$\gamma\f$ and \f$e^-/e^+\f$ steps per-layer) into files
  * while all the other collected data to the screen.*/
 void WriteResults(struct Results& res, int numEvents=1);
 
+/** Merges the results collected by a worker into the run results.
+ *
+ * All run scope data (histograms, accumulators, sums) of `from` are added to those of `to`. The per-event data
+ * and the AD inputs/bar values of the edeps (i.e. the per-event state) of `to` are not changed.*/
+void MergeResults(struct Results& to, const struct Results& from);
+
 #endif // RESULTS_HH
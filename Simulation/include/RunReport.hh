@@ -0,0 +1,60 @@
+#include "ad_type.h"
+
+
+#ifndef RUNREPORT_HH
+#define RUNREPORT_HH
+
+/**
+ * @file    RunReport.hh
+ * @struct  RunReport
+ *
+ * @brief Machine-readable (JSON) report of a run: configuration, throughput, resource usage and physics summary.
+ *
+ * The report is written by `WriteRunReport()` at the end of the run when
+ * required (`-J` input argument). Its schema is stable (identified by the
+ * `schema` and `schemaVersion` fields), i.e. all fields are always present and
+ * the not available ones (e.g. tape statistics in non reverse-mode builds or the
+ * not measured hardware performance counters) are `null`. The top level fields:
+ * - `build`: AD mode of the build and the compiled instruments
+ * - `parameters`: the input parameters of the run, including the data `preset`,
+ *   the `numaNodes` of the workers and the number of `trackThreads`
+ * - `performance`: wall and CPU time of the event loop, the number of
+ *   `configurationsPerEvent` (3 with finite differences), events and steps per
+ *   second of one configuration, events per second of all the configurations,
+ *   peak resident set size and peak `TrackStack` depth
+ * - `physics`: mean and standard deviation of the energy deposit in the absorber
+ *   and gap, mean number of secondaries and steps per event and the mean energy
+ *   deposit per layer with its standard error
+ * - `tape`: reverse-mode AD tape statistics per event (`null` otherwise)
+ * - `perfCounters`: the hardware performance counters per phase (`null` if not
+ *   measured)
+ */
+
+#include <string>
+#include <vector>
+#include <utility>
+
+struct Results;
+
+struct RunReport {
+  static constexpr int kSchemaVersion = 1;  ///< version of the report schema
+
+  std::vector<std::pair<std::string, std::string>> fParameters; ///< the input parameters: name and JSON value
+  std::string fRunMode;           ///< "primal" or the AD mode of the build
+  int         fNumThreads {  1 }; ///< number of worker threads
+  int         fNumConfigs {  1 }; ///< number of configurations simulated per event (3 with finite differences)
+  double      fWallTime   {0.0};  ///< wall-clock time of the event loop in [s]
+  double      fCPUTime    {0.0};  ///< CPU time (all threads) of the event loop in [s]
+
+  /** Adds a string input parameter.*/
+  void AddParameter(const std::string& name, const std::string& value);
+  /** Adds a numeric input parameter.*/
+  void AddParameter(const std::string& name, double value);
+};
+
+/** Writes the report of the run, with the `Results` of its `numEvents` events, into the given file (JSON).
+ *
+ * Must be called before `WriteResults()` (that normalises some of the results).*/
+void WriteRunReport(const std::string& fileName, const RunReport& report, const Results& res, int numEvents);
+
+#endif // RUNREPORT_HH
@@ -0,0 +1,195 @@
+#ifndef STEPSTATISTICS_HH
+#define STEPSTATISTICS_HH
+
+/**
+ * @file    StepStatistics.hh
+ * @struct  StepStatistics
+ *
+ * @brief Optional heatmap of the simulation steps by particle, material, kinetic energy and step limiter.
+ *
+ * The steppers of the `SteppingLoop` are instrumented with the
+ * `HEPEMSHOW_STEP_BEGIN(ekin)`, at the pre-step point, and the
+ * `HEPEMSHOW_STEP_END(particle, material, limiter)`, at the end of each
+ * simulation step, macros that count the steps in bins of:
+ * - the particle type: \f$\gamma\f$, \f$e^-\f$ or \f$e^+\f$
+ * - the material index of the volume in which the step was done (`{0 - G4_Galactic;
+ *   1 - G4_PbWO4, 2 - G4_lAr}` with the default materials)
+ * - the pre-step point kinetic energy decade: `< 1 keV`, 9 decades from 1 keV to
+ *   1 TeV and `>= 1 TeV`
+ * - the step limiter: physics, geometry (the step ended on boundary) or zero-length
+ *   push (relocation)
+ *
+ * When the phase timers are also enabled (see `PhaseTimers`), the time stamp
+ * counter ticks of the steps are accumulated in the same bins.
+ *
+ * The counts are accumulated into a thread local `StepStatistics` object that is
+ * collected into the `Results` of the thread at the end of the event loop
+ * (`CollectStepStatistics`), merged over the threads and written by `WriteResults()`
+ * to the `step_statistics` file (one line per non-empty bin) while a summary table
+ * is printed to the standard output.
+ *
+ * The step statistics are compiled only when `HEPEMSHOW_STEP_STATISTICS` is
+ * defined (CMake option `-DHepEmShow_STEP_STATISTICS=ON`). Otherwise, the macros
+ * are empty.
+ */
+
+/** The step limiters.*/
+enum EStepLimiter {
+  kStepLimiterPhysics = 0,   ///< the step was limited by the physics (`HowFar`)
+  kStepLimiterGeometry,      ///< the step was limited by the geometry (ended on boundary)
+  kStepLimiterPush,          ///< zero-length step: small push and relocation
+  kNumStepLimiters
+};
+
+
+#ifdef HEPEMSHOW_STEP_STATISTICS
+
+#include "PhaseTimers.hh"
+
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+struct StepStatistics {
+  static constexpr int kNumParticles  =  3;  ///< \f$\gamma\f$, \f$e^-\f$ and \f$e^+\f$
+  static constexpr int kMaxMaterials  =  8;  ///< material indices above are counted in the last bin
+  static constexpr int kNumEnergyBins = 11;  ///< `< 1 keV`, 9 decades from 1 keV to 1 TeV and `>= 1 TeV`
+  static constexpr int kNumBins       = kNumParticles*kMaxMaterials*kNumEnergyBins*kNumStepLimiters;
+
+  std::uint64_t fSteps[kNumBins] = {};  ///< number of steps per bin
+  std::uint64_t fTicks[kNumBins] = {};  ///< accumulated time stamp counter ticks per bin (only with the phase timers)
+
+  /** Particle index from the charge.*/
+  static inline int ParticleIndex(double charge) {
+    return charge == 0.0 ? 0 : (charge < 0.0 ? 1 : 2);
+  }
+
+  /** Kinetic energy bin index (energy in [MeV] units).*/
+  static inline int EnergyBin(double ekin) {
+    const int ie = ekin > 0.0 ? static_cast<int>(std::floor(std::log10(ekin))) + 4 : 0;
+    return ie < 0 ? 0 : (ie > kNumEnergyBins-1 ? kNumEnergyBins-1 : ie);
+  }
+
+  static inline int BinIndex(int particle, int material, int ebin, int limiter) {
+    const int imat = material < 0 ? 0 : (material > kMaxMaterials-1 ? kMaxMaterials-1 : material);
+    return ((particle*kMaxMaterials + imat)*kNumEnergyBins + ebin)*kNumStepLimiters + limiter;
+  }
+
+  /** The step statistics of the calling thread.*/
+  static inline StepStatistics& ThreadLocal() {
+    static thread_local StepStatistics theStepStatistics;
+    return theStepStatistics;
+  }
+
+  /** Time stamp at the pre-step point (zero when the phase timers are not enabled).*/
+  static inline std::uint64_t Now() {
+    #ifdef HEPEMSHOW_PHASE_TIMERS
+      return PhaseTimers::Now();
+    #else
+      return 0;
+    #endif
+  }
+
+  /** Adds one step to the calling thread.*/
+  static inline void Add(int particle, int material, double ekin, int limiter, std::uint64_t start) {
+    StepStatistics& s = ThreadLocal();
+    const int indx = BinIndex(particle, material, EnergyBin(ekin), limiter);
+    s.fSteps[indx] += 1;
+    #ifdef HEPEMSHOW_PHASE_TIMERS
+      s.fTicks[indx] += PhaseTimers::Now() - start;
+    #else
+      (void)start;
+    #endif
+  }
+
+  /** Adds the step statistics of the other (e.g. of an other thread) to this.*/
+  void Merge(const StepStatistics& other) {
+    for (int i = 0; i < kNumBins; ++i) {
+      fSteps[i] += other.fSteps[i];
+      fTicks[i] += other.fTicks[i];
+    }
+  }
+
+  /** Lower edge of the given kinetic energy bin in [MeV] units.*/
+  static double EnergyBinLowEdge(int ebin) {
+    return ebin == 0 ? 0.0 : std::pow(10.0, ebin-4);
+  }
+
+  /** Writes one line per non-empty bin: particle, material, energy bin edges [MeV], limiter, steps and ticks.*/
+  void WriteToFile(const std::string& fileName) const {
+    static const char* particles[kNumParticles] = { "gamma", "e-", "e+" };
+    static const char* limiters[kNumStepLimiters] = { "physics", "geometry", "push" };
+    FILE* f = fopen(fileName.c_str(), "w");
+    if (!f) {
+      std::cerr << "\n ***** ERROR in StepStatistics::WriteToFile  "
+                << " cannot create the file = " << fileName
+                << std::endl;
+      exit(1);
+    }
+    fprintf(f, "# particle\tmaterial\tEmin[MeV]\tEmax[MeV]\tlimiter\tsteps\tticks\n");
+    for (int ip = 0; ip < kNumParticles; ++ip) {
+      for (int im = 0; im < kMaxMaterials; ++im) {
+        for (int ie = 0; ie < kNumEnergyBins; ++ie) {
+          for (int il = 0; il < kNumStepLimiters; ++il) {
+            const int indx = BinIndex(ip, im, ie, il);
+            if (fSteps[indx] == 0) continue;
+            const double emax = ie == kNumEnergyBins-1 ? INFINITY : EnergyBinLowEdge(ie+1);
+            fprintf(f, "%s\t%d\t%g\t%g\t%s\t%llu\t%llu\n", particles[ip], im, EnergyBinLowEdge(ie), emax, limiters[il],
+                    (unsigned long long)fSteps[indx], (unsigned long long)fTicks[indx]);
+          }
+        }
+      }
+    }
+    fclose(f);
+  }
+
+  /** Prints the number of steps per kinetic energy bin for each (non-empty) particle, material and limiter.*/
+  void Print(std::ostream& os) const {
+    static const char* particles[kNumParticles] = { "gamma", "e-", "e+" };
+    static const char* limiters[kNumStepLimiters] = { "phys", "geom", "push" };
+    os << " --- Step statistics (steps per pre-step kinetic energy [MeV] bin) ---- " << std::endl;
+    os << "  " << std::left << std::setw(18) << "part. mat. limit." << std::right;
+    for (int ie = 0; ie < kNumEnergyBins; ++ie) {
+      // lower edge of the bin (upper edge of the first)
+      const std::string label = ie == 0 ? "<1e-3" : (ie == kNumEnergyBins-1 ? ">=" : "") + ("1e" + std::to_string(ie-4));
+      os << std::setw(10) << label;
+    }
+    os << std::endl;
+    for (int ip = 0; ip < kNumParticles; ++ip) {
+      for (int im = 0; im < kMaxMaterials; ++im) {
+        for (int il = 0; il < kNumStepLimiters; ++il) {
+          std::uint64_t sum = 0;
+          for (int ie = 0; ie < kNumEnergyBins; ++ie) sum += fSteps[BinIndex(ip, im, ie, il)];
+          if (sum == 0) continue;
+          os << "  " << std::left << std::setw(6) << particles[ip] << std::setw(6) << im << std::setw(6) << limiters[il] << std::right;
+          for (int ie = 0; ie < kNumEnergyBins; ++ie) {
+            os << std::setw(10) << fSteps[BinIndex(ip, im, ie, il)];
+          }
+          os << std::endl;
+        }
+      }
+    }
+    os << " ------------------------------------------------------------\n";
+  }
+};
+
+/** Adds the step statistics of the calling thread to the given one and resets them.*/
+inline void CollectStepStatistics(StepStatistics& to) {
+  to.Merge(StepStatistics::ThreadLocal());
+  StepStatistics::ThreadLocal() = StepStatistics();
+}
+
+#define HEPEMSHOW_STEP_BEGIN(ekin)                     const double stepEKin = (ekin); const std::uint64_t stepStart = StepStatistics::Now()
+#define HEPEMSHOW_STEP_END(particle, material, limiter) StepStatistics::Add(particle, material, stepEKin, limiter, stepStart)
+
+#else
+
+#define HEPEMSHOW_STEP_BEGIN(ekin)
+#define HEPEMSHOW_STEP_END(particle, material, limiter)
+
+#endif // HEPEMSHOW_STEP_STATISTICS
+
+#endif // STEPSTATISTICS_HH
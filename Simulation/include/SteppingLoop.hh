@@ -124,11 +124,9 @@ public:
    */
   static void ElectronStepper(G4HepEmTLData& theTLData, G4HepEmState& theState, TrackStack& theTrackStack, Geometry& theGeometry, Results& theResult, int eventID);
 
-
-private:
-  SteppingLoop() = delete;
-
   /** Auxiliary method that pushes the secondary track(s), produced by physics interactions at the post-step point (if any), into the track stack.
+   *
+   * @note Public only to make it available for the microbenchmarks (`HepEmShow-bench`).
    *
    * @param theTLData the `G4HepEm` specific (thread local) object that is used by `G4HepEm` to deliver the secondary tracks to the caller after calling the its `Perform` top level method
    * @param theTrackStack the track stack that is used to store the secondary tracks produced while simulating the entire history of the input track in the steppers
@@ -136,6 +134,11 @@ private:
    */
   static void StackSecondaries(G4HepEmTLData& theTLData, TrackStack& theTrackStack, G4HepEmTrack& thePrimary);
 
+
+private:
+  SteppingLoop() = delete;
+
+
   /** This method is called at the end of each simulation steps to collect some data during the simulation.
    *
    * This method provides the possibility of collecting some data after each simulation steps (e.g. energy deposit or length of the step).
@@ -0,0 +1,92 @@
+#include "ad_type.h"
+
+
+#ifndef STOPPINGRULE_HH
+#define STOPPINGRULE_HH
+
+/**
+ * @file    StoppingRule.hh
+ * @class   StoppingRule
+ *
+ * @brief Adaptive termination of the event loop on statistical precision or on a wall-clock time budget.
+ *
+ * The number of events given by `-n` is the maximum number of events when a
+ * stopping rule is used. The event loops check the rule after each batch of
+ * events (of each worker), so the cost is negligible. The run ends when:
+ * - the relative standard error \f$ \sqrt{\sigma^2/n}/|\mu| \f$ of all the
+ *   selected accumulators is below the target precision (`-E`) or
+ * - the wall-clock time of the event loop reached the time budget (`-W`)
+ *
+ * The selected accumulators are the mean energy deposit per layer
+ * (`fEdepPerLayer_Acc`) of the selected layers (`-L`, all by default) or, with
+ * `-D` in AD builds, the derivative accumulators: the dot values of the energy
+ * deposit of the selected layers (`fEdepPerLayer_AccD`) in forward-mode and the
+ * bar values of the inputs (`barThicknessAbsorber`, `barThicknessGap` and
+ * `barParticleEnergy`) in reverse-mode. Accumulators with zero mean never reach
+ * the target precision (use the layer selection or the time budget then).
+ *
+ * Each worker hands over a copy of its selected accumulators at its batch
+ * boundaries, so the precision is evaluated on the accumulators of all workers.
+ */
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <iostream>
+#include "accumulator.hh"
+
+struct Results;
+
+class StoppingRule {
+
+public:
+
+  /** Reasons of stopping the event loop.*/
+  enum EReason { kMaxEvents = 0, kPrecision, kTimeBudget };
+
+  /** CTR.
+   *
+   * @param targetRelError the target relative standard error of the selected accumulators (not used if <= 0)
+   * @param timeBudget the wall-clock time budget of the event loop in [s] (not used if <= 0)
+   * @param layers the indices of the selected layers (all if empty)
+   * @param derivatives if the derivative accumulators are selected (AD builds only)
+   * @param batchSize the number of events (of each worker) between two checks
+   */
+  StoppingRule(double targetRelError, double timeBudget, const std::vector<int>& layers, bool derivatives, int batchSize);
+
+  /** Number of events (of each worker) between two checks.*/
+  int  GetBatchSize() const { return fBatchSize; }
+
+  /** Starts the clock of the time budget with the given number of workers (at the start of the event loop).*/
+  void Start(int numWorkers);
+
+  /** Hands over the current accumulators of the given worker and checks the rule (at its batch boundaries, thread safe).
+   *
+   * @return true if the event loop should be terminated.
+   */
+  bool Check(int workerID, const Results& theResult);
+
+  /** Reason of stopping (`kMaxEvents` if the rule did not terminate the event loop).*/
+  EReason GetReason() const { return fReason; }
+
+  /** Prints the reason of stopping and the reached precision.*/
+  void Print(std::ostream& os) const;
+
+private:
+  /** The selected accumulators of the given results.*/
+  std::vector<Accumulator<double>> Select(const Results& theResult) const;
+
+private:
+  double           fTargetRelError;  ///< target relative standard error
+  double           fTimeBudget;      ///< wall-clock time budget in [s]
+  std::vector<int> fLayers;          ///< selected layers (all if empty)
+  bool             fDerivatives;     ///< if the derivative accumulators are selected
+  int              fBatchSize;       ///< number of events between two checks
+  double           fStartTime;       ///< wall-clock time stamp of the start of the event loop
+  double           fMaxRelError;     ///< the largest relative standard error at the last check
+  EReason          fReason;          ///< reason of stopping
+  std::vector<std::vector<Accumulator<double>>> fWorkerAccs; ///< the last handed over accumulators of the workers
+  std::mutex       fMutex;           ///< protects the above at the checks
+};
+
+#endif // STOPPINGRULE_HH
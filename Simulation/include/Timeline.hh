@@ -0,0 +1,82 @@
+#ifndef TIMELINE_HH
+#define TIMELINE_HH
+
+/**
+ * @file    Timeline.hh
+ * @class   Timeline
+ *
+ * @brief Optional timeline recorder of the run written as Chrome trace-event JSON.
+ *
+ * When enabled (`-T` input argument), the begin and end time of each event, of
+ * each track (`-x` input argument, recorded by the `BeginOfTrackingAction()`/
+ * `EndOfTrackingAction()`) and of the output writing are recorded into the
+ * buffer of the calling thread. At the end of the run, the buffers of all
+ * threads are written into a Chrome trace-event JSON file that can be opened
+ * by Perfetto (`ui.perfetto.dev`) or `chrome://tracing`, e.g. to find the tail
+ * latency events or the load imbalance of the worker threads.
+ *
+ * Each thread records into its own ring buffer, so recording needs no locks.
+ * The buffer starts small and grows on demand (i.e. recording allocates only
+ * when the buffer grows) till its maximum size. When a buffer is full, the
+ * oldest records are overwritten (i.e. the end of the run is kept)
+ * and the number of the lost records is reported. The buffers are written by
+ * `Write()` after all worker threads have been joined.
+ *
+ * When the timeline is not enabled, recording costs only the check of a flag.
+ */
+
+#include <cstdint>
+#include <string>
+
+class Timeline {
+
+public:
+
+  /** The kinds of the recorded spans.*/
+  enum EKind { kEvent = 0, kTrack, kOutput };
+
+  /** Initial number of records of the ring buffer of each thread.*/
+  static constexpr std::size_t kInitialCapacity = std::size_t(1) << 10;
+
+  /** Maximum number of records in the ring buffer of each thread.*/
+  static constexpr std::size_t kCapacity = std::size_t(1) << 20;
+
+  /** Enables the recording (before any worker thread is started), with or without the tracks.*/
+  static void Enable(bool withTracks);
+
+  /** If the recording is enabled.*/
+  static inline bool IsEnabled() { return gEnabled; }
+
+  /** If the tracks are also recorded.*/
+  static inline bool IsTracksEnabled() { return gTracks; }
+
+  /** Time [ns] since the timeline was enabled.*/
+  static std::uint64_t Now();
+
+  /** Sets the name of the calling thread (shown in the trace viewer).*/
+  static void SetThreadName(const std::string& name);
+
+  /** Records a span of the given kind (with the given ID and type) from `start` till now into the buffer of the calling thread.*/
+  static void Record(int kind, std::uint64_t start, int id, int type = 0);
+
+  /** Marks the start of an event, track or output span on the calling thread (spans of the same kind do not nest).*/
+  static inline void Begin(int kind) {
+    if (gEnabled) tStart[kind] = Now();
+  }
+
+  /** Records the span, started by `Begin()`, of the given kind (with the given ID and type).*/
+  static inline void End(int kind, int id, int type = 0) {
+    if (gEnabled) Record(kind, tStart[kind], id, type);
+  }
+
+  /** Writes the records of all threads to the given file (Chrome trace-event JSON format).*/
+  static void Write(const std::string& fileName);
+
+private:
+
+  static bool gEnabled;                          ///< if the recording is enabled
+  static bool gTracks;                           ///< if the tracks are also recorded
+  static thread_local std::uint64_t tStart[3];   ///< start of the current span of each kind on the calling thread
+};
+
+#endif // TIMELINE_HH
@@ -0,0 +1,42 @@
+#include "ad_type.h"
+
+#ifndef TOOLSETUP_HH
+#define TOOLSETUP_HH
+
+/**
+ * @file    ToolSetup.hh
+ *
+ * @brief The input argument handling and the set up shared by the `HepEmShow` tools.
+ *
+ * The tools (`HepEmShow-ADBench`, `-regression`, `-sweep`, `-optimize` and
+ * `-mlmc`) have their own input arguments (`getopt`) but the same primary
+ * particle (`-p`), data file (`-d`) and calorimeter configuration: these are
+ * checked and set up by the functions below (the `G4HepEm` data is loaded by
+ * `LoadG4HepEmState()`).
+ */
+
+#include <string>
+
+class Geometry;
+class PrimaryGenerator;
+
+/** Checks that the name is one of the primary particles: "e-", "e+" or "gamma".*/
+bool IsValidParticleName(const std::string& name);
+
+/** Checks the primary particle name of the `-p` input argument: reports the error, calls `help` and exits if not valid.*/
+void CheckParticleName(const std::string& name, void (*help)());
+
+/** Returns the `G4HepEm` data file of the `-d` input argument with its `.json` extension (appended if not given).*/
+std::string G4HepEmDataFileName(const std::string& name);
+
+/** Returns the charge of the primary particle of the given name: -1, +1 or 0 for e-, e+ or gamma.*/
+double ParticleCharge(const std::string& name);
+
+/** Sets the number of layers and the absorber and gap thicknesses [mm] of the geometry.*/
+void SetUpGeometry(Geometry& theGeometry, int numLayers, G4double thickAbs, G4double thickGap);
+
+/** Sets the particle and kinetic energy [MeV] of the primary generator with its position in front of the geometry and
+ *  its direction along the +x axis (must be called again if the size of the geometry changes).*/
+void SetUpPrimaryGenerator(PrimaryGenerator& thePrimaryGenerator, const std::string& particleName, G4double energy, const Geometry& theGeometry);
+
+#endif // TOOLSETUP_HH
@@ -1,6 +1,7 @@
 #include "ad_type.h"
 
-#ifndef TrackStack_HH
+
+#ifndef TrackStack_HH
 #define TrackStack_HH
 
 /**
@@ -75,11 +76,18 @@ public:
   void Copy(G4HepEmTrack& from, G4HepEmTrack& to);
 
 
+  /** Moves all tracks of this stack into the `to` stack (in the same order, with new track IDs of `to`) and returns their number.*/
+  int  MoveInto(TrackStack& to);
+
+
   /** Returns with the next track ID (track ID is incremented whenever this method is invoked).*/
   int  GetNextTrackID() { return fCurrentTrackID++; }
   /** Resets the track ID to zero.*/
   void ReSetTrackID()   { fCurrentTrackID=0; }
 
+  /** Returns with the maximum number of tracks that were in the stack at the same time.*/
+  int  GetPeakDepth() const { return fPeakDepth; }
+
 
 
 private:
@@ -87,6 +95,7 @@ private:
   int fSize;                             ///< current capacity of the track stack
   int fCurIndx;                          ///< number of tracks used from the capacity
   int fCurrentTrackID;                   ///< current track ID
+  int fPeakDepth;                        ///< maximum number of tracks in the stack (since its construction)
   std::vector<G4HepEmTrack> fTrackVect;  ///< the stack as a vector of tracks
 };
 
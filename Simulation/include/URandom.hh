@@ -27,6 +27,7 @@
  */
 
 #include <random>
+#include <cstdint>
 
 class URandom {
 public:
@@ -42,6 +43,23 @@ public:
    /** Method to provide uniform random numbers on \f$(0,1)\f$ */
    G4double flat();
 
+   /** Re-seeds the generator (e.g. at the beginning of an event, see `EventSeed()`).
+    *
+    * @param seed the new seed of the random number generator.
+    */
+   void SetSeed(std::uint64_t seed);
+
+   /** Provides the seed of an event derived from the seed of the run and the ID of the event.
+    *
+    * Events simulated with these seeds can be reproduced individually, independently
+    * from the other events (see `EventRecord`).
+    *
+    * @param runSeed seed of the run.
+    * @param eventID ID of the event.
+    * @return the seed of the event.
+    */
+   static std::uint64_t EventSeed(std::uint64_t runSeed, int eventID);
+
 public:
    /** c++11 implementation of the 64-bit Mersenne Twister engine */
    std::mt19937_64 fEngine;
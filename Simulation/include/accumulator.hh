@@ -1,3 +1,7 @@
+#ifndef ACCUMULATOR_HH
+#define ACCUMULATOR_HH
+
+#include <cstddef>
 #include <set>
 
 template<typename Scalar>
@@ -23,11 +27,31 @@ public:
     n += 1;
     if(nmins>0){
       mins.insert(x);
-      if(mins.size()>nmins) mins.erase(mins.begin());
+      if(mins.size()>static_cast<std::size_t>(nmins)) mins.erase(mins.begin());
     }
     if(nmaxs>0){
       maxs.insert(x);
-      if(maxs.size()>nmaxs) maxs.erase(maxs.begin());
+      if(maxs.size()>static_cast<std::size_t>(nmaxs)) maxs.erase(maxs.begin());
+    }
+  }
+
+  /*! Register all data points that were previously registered in an other accumulator.
+   *
+   * Used to combine the accumulators of several workers. The outliers of the
+   * combined data are among the outliers of the two parts, so the same number
+   * of outliers is kept after merging.
+   */
+  void merge(const Accumulator& other){
+    sum = sum + other.sum;
+    sq_sum = sq_sum + other.sq_sum;
+    n += other.n;
+    for(Scalar s : other.mins){
+      mins.insert(s);
+      if(mins.size()>static_cast<std::size_t>(nmins)) mins.erase(mins.begin());
+    }
+    for(Scalar s : other.maxs){
+      maxs.insert(s);
+      if(maxs.size()>static_cast<std::size_t>(nmaxs)) maxs.erase(maxs.begin());
     }
   }
 
@@ -44,6 +68,12 @@ public:
     return (sum-extremes_sum)/(n-nmins-nmaxs);
   }
 
+  /*! Get the number of the registered data points (including the outliers).
+   */
+  unsigned long long getCount() const {
+    return n;
+  }
+
   Scalar getVar() const {
     return getMeanSq() - getMean()*getMean();
   }
@@ -61,3 +91,5 @@ public:
     return (sq_sum-extremes_sq_sum)/(n-nmins-nmaxs);
   }
 };
+
+#endif // ACCUMULATOR_HH
@@ -0,0 +1,201 @@
+#include "AllocTracker.hh"
+
+// NOTE: the entire file is compiled only when the allocation tracking is required
+#ifdef HEPEMSHOW_ALLOC_TRACKING
+
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+#include <algorithm>
+
+#ifdef __GLIBC__
+// the allocation functions of the C library behind the replacements of `malloc` below
+extern "C" {
+  void* __libc_malloc(std::size_t size);
+  void* __libc_calloc(std::size_t num, std::size_t size);
+  void* __libc_realloc(void* p, std::size_t size);
+  void  __libc_free(void* p);
+}
+#endif
+
+namespace {
+  // the allocation counters of the thread (plain data: no dynamic initialisation
+  // is needed, so they can be used in the `operator new` of any thread)
+  thread_local int           tPhase = -1;
+  thread_local std::uint64_t tAllocs[kNumPhases];
+  thread_local std::uint64_t tBytes[kNumPhases];
+
+  inline void Count(std::size_t size) {
+    const int phase = tPhase;
+    if (phase > -1) {
+      tAllocs[phase] += 1;
+      tBytes[phase]  += size;
+    }
+  }
+
+  // the `malloc` that does not count the allocation (the `operator new` below counts it)
+  inline void* RawMalloc(std::size_t size) {
+    #ifdef __GLIBC__
+      return __libc_malloc(size);
+    #else
+      return std::malloc(size);
+    #endif
+  }
+
+  inline void* Allocate(std::size_t size) {
+    Count(size);
+    void* p = RawMalloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+      throw std::bad_alloc();
+    }
+    return p;
+  }
+
+  // the phases of the stepping loop (that must be allocation free in the steady state)
+  inline bool IsSteppingPhase(int phase) {
+    return phase == kPhaseTrackStack || (phase >= kPhaseNavigation && phase <= kPhaseSteppingAction);
+  }
+}
+
+
+// replacements of the global `operator new/delete` (aligned forms are not replaced
+// as they are not used by the simulation)
+void* operator new  (std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+void* operator new  (std::size_t size, const std::nothrow_t&) noexcept { Count(size); return RawMalloc(size == 0 ? 1 : size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { Count(size); return RawMalloc(size == 0 ? 1 : size); }
+void  operator delete  (void* p) noexcept { std::free(p); }
+void  operator delete[](void* p) noexcept { std::free(p); }
+void  operator delete  (void* p, std::size_t) noexcept { std::free(p); }
+void  operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void  operator delete  (void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void  operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+
+
+#ifdef __GLIBC__
+// replacements of the C allocation functions (used instead of the ones of the C library
+// by all the libraries of the process, e.g. direct `malloc` calls by C code): the memory
+// is still managed by the C library so `free` works with any of them (the aligned ones,
+// `posix_memalign`, `aligned_alloc` and `memalign`, are not replaced, i.e. not counted)
+extern "C" {
+  void* malloc (std::size_t size) { Count(size); return __libc_malloc(size); }
+  void* calloc (std::size_t num, std::size_t size) { Count(num*size); return __libc_calloc(num, size); }
+  void* realloc(void* p, std::size_t size) { Count(size); return __libc_realloc(p, size); }
+  void  free   (void* p) { __libc_free(p); }
+}
+#endif
+
+
+int AllocTracker::SetPhase(int phase) {
+  const int previous = tPhase;
+  tPhase = phase;
+  return previous;
+}
+
+
+void AllocTracker::BeginEvent(EventSnapshot& snapshot) {
+  for (int i = 0; i < kNumPhases; ++i) {
+    snapshot.fAllocs[i] = tAllocs[i];
+    snapshot.fBytes[i]  = tBytes[i];
+  }
+}
+
+
+void AllocTracker::EndEvent(const EventSnapshot& snapshot, AllocStatistics& stat, int eventID) {
+  EventSnapshot counts = EventSnapshot();
+  EventSnapshot current(snapshot);
+  Collect(current, counts);
+  AddEvent(counts, stat, eventID);
+}
+
+
+void AllocTracker::Collect(EventSnapshot& snapshot, EventSnapshot& counts) {
+  for (int i = 0; i < kNumPhases; ++i) {
+    counts.fAllocs[i]  += tAllocs[i] - snapshot.fAllocs[i];
+    counts.fBytes[i]   += tBytes[i]  - snapshot.fBytes[i];
+    snapshot.fAllocs[i] = tAllocs[i];
+    snapshot.fBytes[i]  = tBytes[i];
+  }
+}
+
+
+void AllocTracker::Add(const EventSnapshot& counts, EventSnapshot& to) {
+  for (int i = 0; i < kNumPhases; ++i) {
+    to.fAllocs[i] += counts.fAllocs[i];
+    to.fBytes[i]  += counts.fBytes[i];
+  }
+}
+
+
+void AllocTracker::AddEvent(const EventSnapshot& counts, AllocStatistics& stat, int eventID) {
+  // steady state: not the first event (of this thread)
+  const bool isSteady = stat.fNumEvents > 0;
+  std::uint64_t numAllocs = 0;
+  for (int i = 0; i < kNumPhases; ++i) {
+    const std::uint64_t allocs = counts.fAllocs[i];
+    stat.fAllocs[i] += allocs;
+    stat.fBytes[i]  += counts.fBytes[i];
+    numAllocs       += allocs;
+    if (isSteady && allocs > 0 && IsSteppingPhase(i)) {
+      stat.fNumSteadySteppingAllocs += allocs;
+      if (stat.fFirstSteadyEventID < 0) {
+        stat.fFirstSteadyEventID = eventID;
+        stat.fFirstSteadyPhase   = i;
+      }
+    }
+  }
+  stat.fNumEvents += 1;
+  if (numAllocs > 0) {
+    stat.fNumEventsWithAllocs += 1;
+  }
+  if (numAllocs > stat.fMaxAllocsPerEvent) {
+    stat.fMaxAllocsPerEvent = numAllocs;
+  }
+}
+
+
+void AllocStatistics::Merge(const AllocStatistics& other) {
+  for (int i = 0; i < kNumPhases; ++i) {
+    fAllocs[i] += other.fAllocs[i];
+    fBytes[i]  += other.fBytes[i];
+  }
+  fNumEvents               += other.fNumEvents;
+  fNumEventsWithAllocs     += other.fNumEventsWithAllocs;
+  fMaxAllocsPerEvent        = std::max(fMaxAllocsPerEvent, other.fMaxAllocsPerEvent);
+  fNumSteadySteppingAllocs += other.fNumSteadySteppingAllocs;
+  if (fFirstSteadyEventID < 0) {
+    fFirstSteadyEventID = other.fFirstSteadyEventID;
+    fFirstSteadyPhase   = other.fFirstSteadyPhase;
+  }
+}
+
+
+void AllocStatistics::Print(std::ostream& os) const {
+  std::uint64_t numAllocs = 0;
+  std::uint64_t numBytes  = 0;
+  os << " --- Heap allocations in the event loop ------------------------ " << std::endl;
+  os << "  " << std::left << std::setw(20) << "phase" << std::right
+     << std::setw(14) << "allocations" << std::setw(16) << "bytes" << std::endl;
+  for (int i = 0; i < kNumPhases; ++i) {
+    // allocations in the event but not in any of its phases
+    const char* name = i == kPhaseEvent ? "event (other)" : PhaseName(i);
+    os << "  " << std::left << std::setw(20) << name << std::right
+       << std::setw(14) << fAllocs[i] << std::setw(16) << fBytes[i] << std::endl;
+    numAllocs += fAllocs[i];
+    numBytes  += fBytes[i];
+  }
+  const double norm = fNumEvents > 0 ? 1.0/fNumEvents : 0.0;
+  os << std::setprecision(6)
+     << "  mean per event: " << numAllocs*norm << " allocations (" << numBytes*norm << " bytes), maximum: "
+     << fMaxAllocsPerEvent << ", events with allocations: " << fNumEventsWithAllocs << " of " << fNumEvents << std::endl;
+  if (fNumSteadySteppingAllocs > 0) {
+    os << " *** " << fNumSteadySteppingAllocs << " allocation(s) in the steady-state stepping loop (after the first event)"
+       << ", first in event #" << fFirstSteadyEventID << " phase: " << PhaseName(fFirstSteadyPhase) << std::endl;
+  } else {
+    os << "  no allocation in the steady-state stepping loop (after the first event)" << std::endl;
+  }
+  os << " ------------------------------------------------------------\n";
+}
+
+#endif // HEPEMSHOW_ALLOC_TRACKING
@@ -3,6 +3,7 @@
 
 #include "Box.hh"
 
+#include "NavAdjoints.hh"
 
 #include <iostream>
 #include <sstream>
@@ -75,6 +76,32 @@ G4double Box::DistanceToOut(G4double* p, G4double *v) const {
   }
   // Find intersection
   //
+#ifdef HEPEMSHOW_USE_NAV_ADJOINTS
+  // compute the primal and record a single statement on the tape (see `NavAdjoints.hh`):
+  // t = (copysign(fD_k,v_k) - p_k)/v_k along the axis `k` that gives the minimum
+  const G4double* hl[3] = { &fDx, &fDy, &fDz };
+  int    kmin = -1;
+  double tmin = 1.0E+20;
+  for (int k = 0; k < 3; ++k) {
+    const double vk = GET_VALUE(v[k]);
+    if (vk == 0) continue;
+    const double tk = (std::copysign(GET_VALUE(*hl[k]), vk) - GET_VALUE(p[k]))/vk;
+    if (kmin < 0 || tk < tmin) {
+      kmin = k;
+      tmin = tk;
+    }
+  }
+  G4double tmax;
+  if (kmin < 0) {
+    tmax = tmin;
+  } else {
+    const double vk = GET_VALUE(v[kmin]);
+    const G4double* const args[3] = { hl[kmin], &p[kmin], &v[kmin] };
+    const double jacobians[3]     = { 1.0/std::abs(vk), -1.0/vk, -tmin/vk };
+    SetWithPartials(tmax, tmin, args, jacobians);
+  }
+  return tmax;
+#else
   const G4double vx = v[0];
   const G4double tx = (vx == 0) ? 1.0E+20 : (G4double)((std::copysign(fDx,vx) - p[0])/vx);
   //
@@ -87,15 +114,39 @@ G4double Box::DistanceToOut(G4double* p, G4double *v) const {
   const G4double tmax = std::min(txy,tz);
   //
   return tmax;
+#endif
 }
 
 
 G4double Box::DistanceToOut(G4double* p) const {
+#ifdef HEPEMSHOW_USE_NAV_ADJOINTS
+  // compute the primal and record a single statement on the tape (see `NavAdjoints.hh`):
+  // dist = fD_k - |p_k| along the axis `k` that gives the minimum
+  const G4double* hl[3] = { &fDx, &fDy, &fDz };
+  int    kmin = 0;
+  double dmin = GET_VALUE(fDx) - std::abs(GET_VALUE(p[0]));
+  for (int k = 1; k < 3; ++k) {
+    const double dk = GET_VALUE(*hl[k]) - std::abs(GET_VALUE(p[k]));
+    if (dk < dmin) {
+      kmin = k;
+      dmin = dk;
+    }
+  }
+  if (!(dmin > 0)) {
+    return 0.0;
+  }
+  G4double dist;
+  const G4double* const args[2] = { hl[kmin], &p[kmin] };
+  const double jacobians[2]     = { 1.0, GET_VALUE(p[kmin]) < 0 ? 1.0 : -1.0 };
+  SetWithPartials(dist, dmin, args, jacobians);
+  return dist;
+#else
   G4double dist = std::min( std::min(
                    fDx-std::abs(p[0]),
                    fDy-std::abs(p[1]) ),
                    fDz-std::abs(p[2]) );
   return (dist > 0) ? dist : 0.0;
+#endif
 }
 
 
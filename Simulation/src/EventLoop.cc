@@ -6,6 +6,7 @@
 
 #include "G4HepEmTLData.hh"
 #include "G4HepEmState.hh"
+#include "G4HepEmData.hh"
 
 #include "PrimaryGenerator.hh"
 #include "Geometry.hh"
@@ -13,14 +14,34 @@
 
 #include "TrackStack.hh"
 #include "SteppingLoop.hh"
+#include "URandom.hh"
+#include "EventRecord.hh"
+#include "PhaseTimers.hh"
+#include "StepStatistics.hh"
+#include "PerfCounters.hh"
+#include "Timeline.hh"
+#include "LiveMetrics.hh"
+#include "StoppingRule.hh"
+#include "FiniteDifference.hh"
+#include "MultiLevelMC.hh"
+#include "NumaPlacement.hh"
+
+#include "G4HepEmRandomEngine.hh"
 
 
 #include "sys/time.h"
 #include <ctime>
 #include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
 
 
-void EventLoop::ProcessEvents(G4HepEmTLData& theTLData, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, int numEventToSimulate, int verbosity) {
+int EventLoop::ProcessEvents(G4HepEmTLData& theTLData, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, int numEventToSimulate, int verbosity, StoppingRule* theStoppingRule) {
   //
   // first create the container for the tracks, i.e. the track-stack:
   // - before and at the end of a given event processing: empty
@@ -48,6 +69,14 @@ void EventLoop::ProcessEvents(G4HepEmTLData& theTLData, G4HepEmState& theState,
     reportProgress = std::max(1, numEventToSimulate/10);
   }
   //
+  // hardware performance counters of this thread (if required)
+  std::unique_ptr<PerfCounters> thePerfCounters(theResult.fMeasurePerfCounters ? new PerfCounters() : nullptr);
+  std::uint64_t thePerfStart[PerfCounterData::kNumCounters];
+  if (thePerfCounters) thePerfCounters->Read(thePerfStart);
+  //
+  // start the clock of the stopping rule (if any)
+  if (theStoppingRule) theStoppingRule->Start(1);
+  //
   // enter to the event loop: generate and simulate as many events as required
   while (eventID < numEventToSimulate) {
     // report progress if it was rquested
@@ -55,102 +84,694 @@ void EventLoop::ProcessEvents(G4HepEmTLData& theTLData, G4HepEmState& theState,
       std::cout << "      - starts processing #event = " << (eventID+1) << std::endl;
     }
     //
-    // 0. Reset the track ID before each new event such that it starts from zero again.
-    theTrackStack.ReSetTrackID();
+    // simulate this event
+    ProcessOneEvent(theTLData, theState, thePrimaryGenerator, theGeometry, theResult, theTrackStack, eventID, thePerfCounters.get());
     //
-    // 1. Generate the primary track of this event:
-    // NOTE: each event is assumed to have one primary now just for simplicity
-    //       (no problem though with inserting more than one primary into the stack)
-    // - the primary track is the very first track in the stack, so obtain one
-    //   track reference from the stack and generate one primary into that
-    G4HepEmTrack& primaryTrack = theTrackStack.Insert();
-
-    // 2. Invoke the beginning of event action (by passing the current primary track)
-    BeginOfEventAction(theResult, eventID, primaryTrack, theGeometry, thePrimaryGenerator);
-
-    // Continuation of 1.:
-    thePrimaryGenerator.GenerateOne(primaryTrack);
-    primaryTrack.SetID(theTrackStack.GetNextTrackID());
+    // increase the event ID (i.e. counter of simulated events)
+    ++eventID;;
     //
+    // check the stopping rule (if any) at the batch boundaries
+    if (theStoppingRule && eventID % theStoppingRule->GetBatchSize() == 0 && theStoppingRule->Check(0, theResult)) {
+      break;
+    }
+  };
+  if (thePerfCounters) thePerfCounters->Accumulate(theResult.fPerfCounterData, PerfCounterData::kEventLoop, thePerfStart);
+  // collect the phase timers of this thread (if enabled)
+  #ifdef HEPEMSHOW_PHASE_TIMERS
+    CollectPhaseTimers(theResult.fPhaseTimers);
+  #endif
+  #ifdef HEPEMSHOW_STEP_STATISTICS
+    CollectStepStatistics(theResult.fStepStatistics);
+  #endif
+  theResult.fPeakTrackStackDepth = std::max(theResult.fPeakTrackStackDepth, theTrackStack.GetPeakDepth());
+  //
+  // calculate and report the event processing time
+  struct timeval finish;
+  gettimeofday(&finish, NULL);
+  const G4double theTime = ((G4double)(finish.tv_sec-start.tv_sec)*1000000 + (G4double)(finish.tv_usec-start.tv_usec)) / 1000000;
+  if (verbosity > 0) {
+    std::cout << " --- EventLoop::ProcessEvents: completed simulation within t = " << theTime << " [s]" << std::endl;
+    if (theStoppingRule) theStoppingRule->Print(std::cout);
+  }
+  return eventID;
+}
 
+
+void EventLoop::ProcessEventList(G4HepEmTLData& theTLData, URandom& theURnd, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, std::vector<EventRecord>& theEvents, int verbosity) {
+  TrackStack theTrackStack;
+  const int numEventToSimulate = theEvents.size();
+  //
+  // report progress
+  if (verbosity > 0) {
+    std::cout << " --- EventLoop::ProcessEventList: starts simulation of N = " << numEventToSimulate << " recorded events..." << std::endl;
+  }
+  // set the initial time stamp to meaure the event processing time
+  struct timeval start;
+  gettimeofday(&start, NULL);
+  //
+  int reportProgress = -1;
+  if (verbosity > 0) {
+    reportProgress = std::max(1, numEventToSimulate/10);
+  }
+  //
+  // hardware performance counters of this thread (if required)
+  std::unique_ptr<PerfCounters> thePerfCounters(theResult.fMeasurePerfCounters ? new PerfCounters() : nullptr);
+  std::uint64_t thePerfStart[PerfCounterData::kNumCounters];
+  if (thePerfCounters) thePerfCounters->Read(thePerfStart);
+  for (int i = 0; i < numEventToSimulate; ++i) {
+    EventRecord& theEvent = theEvents[i];
+    // report progress if it was rquested
+    if ( verbosity > 0 && (i+1) % reportProgress == 0) {
+      std::cout << "      - starts processing #event = " << (i+1) << " (ID = " << theEvent.fEventID << ")" << std::endl;
+    }
+    // (re-)start the random number generator from the recorded state of this event
+    theURnd.SetSeed(theEvent.fSeed);
+    struct timeval evtStart;
+    gettimeofday(&evtStart, NULL);
     //
+    ProcessOneEvent(theTLData, theState, thePrimaryGenerator, theGeometry, theResult, theTrackStack, theEvent.fEventID, thePerfCounters.get());
     //
-    // 3. While the track-stack becomes empty:
-    //   - pop-up one track (into the `HepEmTLData` primary electron/gamma track)
-    //   - track this particle till the end of its history in a step-by-step way
-    //     NOTE: secondaries are insterted into the track-stack after each step
-    //   Processing/simulation of this event is completed when the track-stack
-    //   becomes empty again
-    //   NOTE: `GetTypeOfNextTrack` returns -1, 0, +1 if the next track in the
-    //          stack is an e-, gamma or e+, while -999 in case of empty stack.
-    int trackType = -1;
-    while ( (trackType = theTrackStack.GetTypeOfNextTrack()) > -2 ) {
+    // record the cost of this event
+    struct timeval evtFinish;
+    gettimeofday(&evtFinish, NULL);
+    theEvent.fTime     = ((double)(evtFinish.tv_sec-evtStart.tv_sec)*1000000 + (double)(evtFinish.tv_usec-evtStart.tv_usec)) / 1000000;
+    theEvent.fEdep     = GET_VALUE(theResult.fPerEventRes.fEdepAbs + theResult.fPerEventRes.fEdepGap);
+    theEvent.fNumSteps = GET_VALUE(theResult.fPerEventRes.fNumStepsGamma + theResult.fPerEventRes.fNumStepsElPos);
+  }
+  if (thePerfCounters) thePerfCounters->Accumulate(theResult.fPerfCounterData, PerfCounterData::kEventLoop, thePerfStart);
+  #ifdef HEPEMSHOW_PHASE_TIMERS
+    CollectPhaseTimers(theResult.fPhaseTimers);
+  #endif
+  #ifdef HEPEMSHOW_STEP_STATISTICS
+    CollectStepStatistics(theResult.fStepStatistics);
+  #endif
+  theResult.fPeakTrackStackDepth = std::max(theResult.fPeakTrackStackDepth, theTrackStack.GetPeakDepth());
+  //
+  // calculate and report the event processing time
+  struct timeval finish;
+  gettimeofday(&finish, NULL);
+  const G4double theTime = ((G4double)(finish.tv_sec-start.tv_sec)*1000000 + (G4double)(finish.tv_usec-start.tv_usec)) / 1000000;
+  if (verbosity > 0) {
+    std::cout << " --- EventLoop::ProcessEventList: completed simulation within t = " << theTime << " [s]" << std::endl;
+  }
+}
+
+
+int EventLoop::ProcessEventsFD(G4HepEmTLData& theTLData, URandom& theURnd, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, FiniteDifference& theFiniteDifference, int numEventToSimulate, std::uint64_t runSeed, int verbosity) {
+  TrackStack theTrackStack;
+  //
+  // the perturbed configurations: copies of the nominal ones (the results only for the differences)
+  Geometry         theGeometryPlus(theGeometry), theGeometryMinus(theGeometry);
+  PrimaryGenerator thePrimaryGeneratorPlus(thePrimaryGenerator), thePrimaryGeneratorMinus(thePrimaryGenerator);
+  theFiniteDifference.Perturb(theGeometryPlus, thePrimaryGeneratorPlus, +1.0);
+  theFiniteDifference.Perturb(theGeometryMinus, thePrimaryGeneratorMinus, -1.0);
+  const int numLayers = theResult.fEdepPerLayer.GetNumBins();
+  Results theResultPlus, theResultMinus;
+  InitResults(theResultPlus, numLayers);
+  InitResults(theResultMinus, numLayers);
+  theResultPlus.fComputeDerivatives  = false;
+  theResultMinus.fComputeDerivatives = false;
+  theFiniteDifference.Init(numLayers);
+  //
+  // report progress
+  if (verbosity > 0) {
+    std::cout << " --- EventLoop::ProcessEventsFD: starts simulation of N = " << numEventToSimulate << " events in 3 configurations..." << std::endl;
+  }
+  // set the initial time stamp to meaure the event processing time
+  struct timeval start;
+  gettimeofday(&start, NULL);
+  //
+  int reportProgress = -1;
+  if (verbosity > 0) {
+    reportProgress = std::max(1, numEventToSimulate/10);
+  }
+  for (int eventID = 0; eventID < numEventToSimulate; ++eventID) {
+    // report progress if it was rquested
+    if ( verbosity > 0 && (eventID+1) % reportProgress == 0) {
+      std::cout << "      - starts processing #event = " << (eventID+1) << std::endl;
+    }
+    // the same random numbers in all configurations: each started from the seed of the event
+    const std::uint64_t theSeed = URandom::EventSeed(runSeed, eventID);
+    theURnd.SetSeed(theSeed);
+    ProcessOneEvent(theTLData, theState, thePrimaryGeneratorMinus, theGeometryMinus, theResultMinus, theTrackStack, eventID, nullptr);
+    theURnd.SetSeed(theSeed);
+    ProcessOneEvent(theTLData, theState, thePrimaryGeneratorPlus, theGeometryPlus, theResultPlus, theTrackStack, eventID, nullptr);
+    theURnd.SetSeed(theSeed);
+    ProcessOneEvent(theTLData, theState, thePrimaryGenerator, theGeometry, theResult, theTrackStack, eventID, nullptr);
+    //
+    theFiniteDifference.AddEvent(theResultPlus, theResultMinus);
+  }
+  #ifdef HEPEMSHOW_PHASE_TIMERS
+    CollectPhaseTimers(theResult.fPhaseTimers);
+  #endif
+  #ifdef HEPEMSHOW_STEP_STATISTICS
+    CollectStepStatistics(theResult.fStepStatistics);
+  #endif
+  theResult.fPeakTrackStackDepth = std::max(theResult.fPeakTrackStackDepth, theTrackStack.GetPeakDepth());
+  //
+  // calculate and report the event processing time
+  struct timeval finish;
+  gettimeofday(&finish, NULL);
+  const G4double theTime = ((G4double)(finish.tv_sec-start.tv_sec)*1000000 + (G4double)(finish.tv_usec-start.tv_usec)) / 1000000;
+  if (verbosity > 0) {
+    std::cout << " --- EventLoop::ProcessEventsFD: completed simulation within t = " << theTime << " [s]" << std::endl;
+  }
+  return numEventToSimulate;
+}
+
+
+int EventLoop::ProcessEventsCoupled(G4HepEmTLData& theTLData, URandom& theURnd, G4HepEmState& theFineState, G4HepEmState* theCoarseState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry,
+                                    Results& theFineResult, Results& theCoarseResult, MultiLevelMC& theMultiLevelMC, int level, int firstEventID, int numEventToSimulate, std::uint64_t levelSeed) {
+  TrackStack theTrackStack;
+  for (int eventID = firstEventID; eventID < firstEventID + numEventToSimulate; ++eventID) {
+    // the same random numbers with both fidelities: each started from the seed of the event
+    const std::uint64_t theSeed = URandom::EventSeed(levelSeed, eventID);
+    theURnd.SetSeed(theSeed);
+    auto start = std::chrono::steady_clock::now();
+    ProcessOneEvent(theTLData, theFineState, thePrimaryGenerator, theGeometry, theFineResult, theTrackStack, eventID, nullptr);
+    const double fineTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double coarseTime = 0.0;
+    if (theCoarseState != nullptr) {
+      theURnd.SetSeed(theSeed);
+      start = std::chrono::steady_clock::now();
+      ProcessOneEvent(theTLData, *theCoarseState, thePrimaryGenerator, theGeometry, theCoarseResult, theTrackStack, eventID, nullptr);
+      coarseTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    theMultiLevelMC.AddEvent(level, theFineResult, theCoarseState != nullptr ? &theCoarseResult : nullptr, fineTime, coarseTime);
+  }
+  theFineResult.fPeakTrackStackDepth = std::max(theFineResult.fPeakTrackStackDepth, theTrackStack.GetPeakDepth());
+  return numEventToSimulate;
+}
+
+
+int EventLoop::ProcessEventsMT(G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, int numEventToSimulate, int numThreads, int seed, int verbosity, StoppingRule* theStoppingRule,
+                               const NumaPlacement* thePlacement) {
+  #if defined(CODI_REVERSE) && !defined(HEPEMSHOW_THREAD_LOCAL_TAPE)
+    // the (global) tape cannot be shared by the workers
+    if (numThreads > 1) {
+      std::cerr << " *** EventLoop::ProcessEventsMT: this reverse-mode AD build has a global tape (configure with"
+                << " -DHepEmShow_THREAD_LOCAL_TAPE=ON for a thread-local tape type): falling back to 1 thread." << std::endl;
+      numThreads = 1;
+    }
+  #endif
+  numThreads = std::max(1, numThreads);
+  //
+  // report progress
+  if (verbosity > 0) {
+    std::cout << " --- EventLoop::ProcessEventsMT: starts simulation of N = " << numEventToSimulate << " events"
+              << " with " << numThreads << " worker threads..." << std::endl;
+  }
+  // set the initial time stamp to meaure the event processing time
+  struct timeval start;
+  gettimeofday(&start, NULL);
+  //
+  int reportProgress = -1;
+  if (verbosity > 0) {
+    reportProgress = std::max(1, numEventToSimulate/10);
+  }
+  //
+  // each worker collects into its own (empty) results, configured as the ones of the
+  // caller, and the events are distributed dynamically by using a shared event counter
+  std::vector<Results> theWorkerResults(numThreads);
+  for (Results& res : theWorkerResults) {
+    InitResults(res, theGeometry.GetNumLayers());
+    res.fComputeDerivatives  = theResult.fComputeDerivatives;
+    res.fMeasurePerfCounters = theResult.fMeasurePerfCounters;
+    #ifdef CODI_REVERSE
+      res.barEdep = theResult.barEdep;
+    #endif
+  }
+  std::atomic<int>     theNextEventID(0);
+  std::atomic<int>     theNumEventsDone(0);
+  std::atomic<bool>    theStop(false);
+  std::mutex           theOutputMutex;
+  //
+  // the state replicas of the NUMA nodes (loaded by the first worker of each node, if required)
+  const int theNumNodes = thePlacement ? thePlacement->GetNumNodes() : 0;
+  std::vector<G4HepEmState*>             theReplicas(theNumNodes, nullptr);
+  std::unique_ptr<std::once_flag[]>      theReplicaFlags(new std::once_flag[std::max(1, theNumNodes)]);
+  if (thePlacement && verbosity > 0) {
+    thePlacement->Print(std::cout);
+  }
+  //
+  // start the clock of the stopping rule (if any)
+  if (theStoppingRule) theStoppingRule->Start(numThreads);
+  //
+  auto theWorker = [&](int workerID) {
+    // pin the worker to the CPUs of its NUMA node and use the state replica of the node (if required):
+    // the replica is loaded by the first worker of the node after pinning so its memory is local
+    G4HepEmState* theWorkerState = &theState;
+    if (thePlacement) {
+      const int node = thePlacement->GetNodeOfWorker(workerID);
+      if (!thePlacement->Pin(node) && workerID == 0) {
+        std::lock_guard<std::mutex> lock(theOutputMutex);
+        std::cerr << " *** EventLoop::ProcessEventsMT: the workers cannot be pinned to their NUMA node." << std::endl;
+      }
+      if (thePlacement->fReplicaLoader) {
+        std::call_once(theReplicaFlags[node], [&]() { theReplicas[node] = thePlacement->fReplicaLoader(); });
+        if (theReplicas[node] != nullptr) {
+          theWorkerState = theReplicas[node];
+        }
+      }
+    }
+    // all thread local objects of this worker:
+    // - the G4HepEm TL-data with its own random engine (re-seeded at each event by
+    //   the seed of the event, so the results do not depend on the scheduling)
+    // - its own copy of the geometry and primary generator (in reverse-mode AD
+    //   these are modified by registering the AD inputs at each event)
+    // - its own track-stack
+    URandom              theURnd(seed + workerID);
+    G4HepEmRandomEngine  theRandomEngine(&theURnd);
+    G4HepEmTLData        theTLData;
+    theTLData.SetRandomEngine(&theRandomEngine);
+    Geometry             theWorkerGeometry(theGeometry);
+    PrimaryGenerator     theWorkerPrimaryGenerator(thePrimaryGenerator);
+    TrackStack           theTrackStack;
+    Results&             theWorkerResult = theWorkerResults[workerID];
+    // - its name on the timeline (if it is recorded)
+    Timeline::SetThreadName("worker #" + std::to_string(workerID));
+    // - its own hardware performance counters (if required)
+    std::unique_ptr<PerfCounters> thePerfCounters(theWorkerResult.fMeasurePerfCounters ? new PerfCounters() : nullptr);
+    std::uint64_t thePerfStart[PerfCounterData::kNumCounters];
+    if (thePerfCounters) thePerfCounters->Read(thePerfStart);
+    int eventID = -1;
+    int numEventsDone = 0;
+    while (!theStop.load(std::memory_order_relaxed) && (eventID = theNextEventID++) < numEventToSimulate) {
+      // report progress if it was rquested
+      if ( verbosity > 0 && (eventID+1) % reportProgress == 0) {
+        std::lock_guard<std::mutex> lock(theOutputMutex);
+        std::cout << "      - starts processing #event = " << (eventID+1) << " (worker #" << workerID << ")" << std::endl;
+      }
+      theURnd.SetSeed(URandom::EventSeed(seed, eventID));
+      ProcessOneEvent(theTLData, *theWorkerState, theWorkerPrimaryGenerator, theWorkerGeometry, theWorkerResult, theTrackStack, eventID, thePerfCounters.get());
+      ++numEventsDone;
+      // check the stopping rule (if any) at the batch boundaries of this worker
+      if (theStoppingRule && numEventsDone % theStoppingRule->GetBatchSize() == 0 && theStoppingRule->Check(workerID, theWorkerResult)) {
+        theStop.store(true, std::memory_order_relaxed);
+      }
+    }
+    theNumEventsDone += numEventsDone;
+    if (thePerfCounters) thePerfCounters->Accumulate(theWorkerResult.fPerfCounterData, PerfCounterData::kEventLoop, thePerfStart);
+    #ifdef HEPEMSHOW_PHASE_TIMERS
+      CollectPhaseTimers(theWorkerResult.fPhaseTimers);
+    #endif
+    #ifdef HEPEMSHOW_STEP_STATISTICS
+      CollectStepStatistics(theWorkerResult.fStepStatistics);
+    #endif
+    theWorkerResult.fPeakTrackStackDepth = std::max(theWorkerResult.fPeakTrackStackDepth, theTrackStack.GetPeakDepth());
+  };
+  std::vector<std::thread> theWorkers;
+  for (int i = 0; i < numThreads; ++i) {
+    theWorkers.emplace_back(theWorker, i);
+  }
+  for (auto& th : theWorkers) {
+    th.join();
+  }
+  for (G4HepEmState* theReplica : theReplicas) {
+    if (theReplica != nullptr) {
+      FreeG4HepEmData(theReplica->fData);
+      delete theReplica;
+    }
+  }
+  //
+  // merge the results of the workers
+  for (const Results& res : theWorkerResults) {
+    MergeResults(theResult, res);
+  }
+  //
+  // calculate and report the event processing time
+  struct timeval finish;
+  gettimeofday(&finish, NULL);
+  const G4double theTime = ((G4double)(finish.tv_sec-start.tv_sec)*1000000 + (G4double)(finish.tv_usec-start.tv_usec)) / 1000000;
+  if (verbosity > 0) {
+    std::cout << " --- EventLoop::ProcessEventsMT: completed simulation within t = " << theTime << " [s]" << std::endl;
+    if (theStoppingRule) theStoppingRule->Print(std::cout);
+  }
+  return theNumEventsDone.load();
+}
+
+
+int EventLoop::ProcessEventsTrackParallel(G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, int numEventToSimulate, int numThreads, int seed, int verbosity,
+                                          StoppingRule* theStoppingRule) {
+  #ifdef CODI_REVERSE
+    // the tape of the event cannot be shared by the workers (neither the global one when the derivatives are not computed)
+    #ifdef HEPEMSHOW_THREAD_LOCAL_TAPE
+      const bool isSharedTape = theResult.fComputeDerivatives;
+    #else
+      const bool isSharedTape = true;
+    #endif
+    if (numThreads > 1 && isSharedTape) {
+      std::cerr << " *** EventLoop::ProcessEventsTrackParallel: the tracks of an event cannot be simulated by more than one thread"
+                << " when recording the tape of the event (or with a global tape): falling back to 1 thread." << std::endl;
+      numThreads = 1;
+    }
+  #endif
+  numThreads = std::max(1, numThreads);
+  //
+  // report progress
+  if (verbosity > 0) {
+    std::cout << " --- EventLoop::ProcessEventsTrackParallel: starts simulation of N = " << numEventToSimulate << " events"
+              << " with " << numThreads << " worker threads per event..." << std::endl;
+  }
+  // set the initial time stamp to meaure the event processing time
+  struct timeval start;
+  gettimeofday(&start, NULL);
+  //
+  int reportProgress = -1;
+  if (verbosity > 0) {
+    reportProgress = std::max(1, numEventToSimulate/10);
+  }
+  //
+  // the track-stack of the current event is the work pool shared by the workers:
+  // - the number of tracks under tracking is counted so the event is completed
+  //   when the pool is empty and none of the workers is tracking
+  // - the helper workers (all but the calling thread) wait for tracks till the
+  //   end of the run
+  TrackStack              thePool;
+  std::mutex              thePoolMutex;
+  std::condition_variable thePoolCondition;
+  int                     theNumTracking = 0;
+  int                     theEventID     = 0;
+  bool                    theRunDone     = false;
+  //
+  // each worker scores into its own per-event buffers (and track length histograms)
+  std::vector<Results> theWorkerResults(numThreads);
+  for (Results& res : theWorkerResults) {
+    InitResults(res, theGeometry.GetNumLayers());
+    res.fComputeDerivatives = theResult.fComputeDerivatives;
+    ResetPerEventResults(res);
+  }
+  //
+  // start the clock of the stopping rule (if any)
+  if (theStoppingRule) theStoppingRule->Start(1);
+  //
+  // all thread local objects of a worker (constructed by the worker for the run):
+  // - the G4HepEm TL-data with its own random engine (seeded by the worker ID)
+  // - its own track-stack into which the secondaries of a track are inserted
+  //   (moved into the pool after tracking the track)
+  // NOTE: the workers navigate in the (read-only) geometry of the caller, i.e. the
+  //       one with the AD input thicknesses registered by `BeginOfEventAction()`
+  //       (it is changed only between the events when none of them is tracking)
+  struct WorkerState {
+    URandom              fURnd;
+    G4HepEmRandomEngine  fRandomEngine;
+    G4HepEmTLData        fTLData;
+    TrackStack           fTrackStack;
+    #ifdef HEPEMSHOW_ALLOC_TRACKING
+      AllocTracker::EventSnapshot fAllocSnapshot;
+    #endif
+    WorkerState(int theSeed) : fURnd(theSeed), fRandomEngine(&fURnd) {
+      fTLData.SetRandomEngine(&fRandomEngine);
+      #ifdef HEPEMSHOW_ALLOC_TRACKING
+        AllocTracker::BeginEvent(fAllocSnapshot);
+      #endif
+    }
+  };
+  #ifdef HEPEMSHOW_ALLOC_TRACKING
+    // the allocations of the helper workers in the current event (collected after each of their tracks)
+    std::vector<AllocTracker::EventSnapshot> theWorkerAllocs(numThreads, AllocTracker::EventSnapshot());
+  #endif
+  //
+  // simulates the tracks of the pool: till the end of the current event on the
+  // calling thread (worker #0) while till the end of the run on the helpers
+  auto theWorker = [&](int workerID, WorkerState* theWS) {
+    Results& theWorkerResult = theWorkerResults[workerID];
+    std::unique_lock<std::mutex> lock(thePoolMutex);
+    while (true) {
+      if (workerID == 0) {
+        thePoolCondition.wait(lock, [&]() { return thePool.GetTypeOfNextTrack() > -2 || theNumTracking == 0; });
+      } else {
+        thePoolCondition.wait(lock, [&]() { return thePool.GetTypeOfNextTrack() > -2 || theRunDone; });
+      }
+      const int trackType = thePool.GetTypeOfNextTrack();
+      if (trackType < -1) {
+        break;
+      }
+      HEPEMSHOW_PHASE_BEGIN(kPhaseTrackStack);
+      // pop the next track from the pool into the primary gamma/electron track of the TL-data (as in `ProcessOneEvent()`)
       G4HepEmTrack* nextTrack = nullptr;
-      // depending if the next track is a gamma or e-/e+ track:
-      if (trackType == 0) { // the next track is a gamma
-        // - obtain the primary gamma track from the TL-data which the next track
-        //   from the stack will be popped into
-        G4HepEmGammaTrack* gTrack = theTLData.GetPrimaryGammaTrack();
-        // - perform the before "start-tracking" procedure: reset the track
-        //   properties and the random engine (throw away cached rnd number)
+      if (trackType == 0) {
+        G4HepEmGammaTrack* gTrack = theWS->fTLData.GetPrimaryGammaTrack();
         gTrack->ReSet();
-        theTLData.GetRNGEngine()->DiscardGauss();
-        // - get the common track part of this primary track
         nextTrack = gTrack->GetTrack();
-      } else { // the next track is an e- or e+
-        // - obtain the primary electron track from the TL-data which the next track
-        //   from the stack will be popped into
-        G4HepEmElectronTrack* eTrack = theTLData.GetPrimaryElectronTrack();
-        // - perform the before "start-tracking" procedure: reset the track
-        //   properties and the random engine (throw away cached rnd number)
+      } else {
+        G4HepEmElectronTrack* eTrack = theWS->fTLData.GetPrimaryElectronTrack();
         eTrack->ReSet();
-        theTLData.GetRNGEngine()->DiscardGauss();
-        // - get the common track part of this primary track
         nextTrack = eTrack->GetTrack();
       }
-      // - pop the next track from the stack into this
-      theTrackStack.PopInto(*nextTrack);
-      // - the simplified "navigation" assumes, that tracks start from inside
-      //   the `calorimeter` volume. This is true for secondary (ParentID > -1)
-      //   tracks by default as they are generated inside the calorimeter but
-      //   not for primary tracks (ParentID = -1) generated outside of the
-      //   calorimeter volume (in the vacuum, pointing to the calorimeter).
-      //   Therefore, primaries need to be moved to the calorimeter boundary
-      //   (as they point into the calorimeter they will be inside then).
+      thePool.PopInto(*nextTrack);
+      const int eventID = theEventID;
+      ++theNumTracking;
+      lock.unlock();
+      //
+      theWS->fTLData.GetRNGEngine()->DiscardGauss();
       if (nextTrack->GetParentID() < 0) {
         G4double* pos = nextTrack->GetPosition();
         pos[0] = theGeometry.GetCaloStartXposition();
       }
-      // - invoke the beginning of tracking action before start tracking this track
-      BeginOfTrackingAction(theResult, *nextTrack);
-      // - call the gamma/electron stepper to simulate the entire history of this
-      //   next-track (provided now in the primary gamma/electron track member of
-      //   the TL-data)
-      //   NOTE: the secondaries, generated during the simulation of the history
-      //         of this track, are all inserted into the track stack.
-      if (trackType == 0) { // the next track is a gamma
-        SteppingLoop::GammaStepper(theTLData, theState, theTrackStack, theGeometry, theResult, eventID);
-      } else {              // the next track is an e- or e+
-        SteppingLoop::ElectronStepper(theTLData, theState, theTrackStack, theGeometry, theResult, eventID);
+      BeginOfTrackingAction(theWorkerResult, *nextTrack);
+      HEPEMSHOW_PHASE_END(kPhaseTrackStack);
+      if (trackType == 0) {
+        SteppingLoop::GammaStepper(theWS->fTLData, theState, theWS->fTrackStack, theGeometry, theWorkerResult, eventID);
+      } else {
+        SteppingLoop::ElectronStepper(theWS->fTLData, theState, theWS->fTrackStack, theGeometry, theWorkerResult, eventID);
+      }
+      EndOfTrackingAction(theWorkerResult, *nextTrack);
+      //
+      // move the secondaries into the pool (with track IDs that are unique in the event, i.e. the same as in
+      // `ProcessOneEvent()` with a single worker) and wake up as many
+      // waiting workers as new tracks (or all, including the calling thread, when the event is completed)
+      lock.lock();
+      const int numNewTracks = theWS->fTrackStack.MoveInto(thePool);
+      #ifdef HEPEMSHOW_ALLOC_TRACKING
+        // the calling thread counts its allocations in the event by its own snapshot
+        if (workerID > 0) AllocTracker::Collect(theWS->fAllocSnapshot, theWorkerAllocs[workerID]);
+      #endif
+      --theNumTracking;
+      if (numNewTracks == 0 && theNumTracking == 0) {
+        thePoolCondition.notify_all();
+      } else {
+        for (int i = 0; i < std::min(numNewTracks, numThreads-1); ++i) {
+          thePoolCondition.notify_one();
+        }
       }
-      // - invoke the end of tracking action when the end of its simulation history is reached
-      EndOfTrackingAction(theResult, *nextTrack);
-    };
+    }
+  };
+  std::vector<std::thread> theHelpers;
+  for (int i = 1; i < numThreads; ++i) {
+    theHelpers.emplace_back([&, i]() {
+      Timeline::SetThreadName("track worker #" + std::to_string(i));
+      WorkerState theWS(seed + i);
+      theWorker(i, &theWS);
+      #ifdef HEPEMSHOW_PHASE_TIMERS
+        CollectPhaseTimers(theWorkerResults[i].fPhaseTimers);
+      #endif
+      #ifdef HEPEMSHOW_STEP_STATISTICS
+        CollectStepStatistics(theWorkerResults[i].fStepStatistics);
+      #endif
+    });
+  }
+  //
+  // enter to the event loop: the primary of each event is inserted into the pool
+  // on this thread that simulates the tracks of the event as worker #0 then
+  WorkerState theWS(seed);
+  int eventID = 0;
+  while (eventID < numEventToSimulate) {
+    // report progress if it was rquested
+    if ( verbosity > 0 && (eventID+1) % reportProgress == 0) {
+      std::cout << "      - starts processing #event = " << (eventID+1) << std::endl;
+    }
+    HEPEMSHOW_PHASE_BEGIN(kPhaseEvent);
+    Timeline::Begin(Timeline::kEvent);
+    #ifdef HEPEMSHOW_ALLOC_TRACKING
+      AllocTracker::EventSnapshot theAllocSnapshot;
+      AllocTracker::BeginEvent(theAllocSnapshot);
+    #endif
+    {
+      HEPEMSHOW_PHASE_SCOPE(kPhaseEventBegin);
+      std::lock_guard<std::mutex> lock(thePoolMutex);
+      theEventID = eventID;
+      thePool.ReSetTrackID();
+      G4HepEmTrack& primaryTrack = thePool.Insert();
+      BeginOfEventAction(theResult, eventID, primaryTrack, theGeometry, thePrimaryGenerator);
+      thePrimaryGenerator.GenerateOne(primaryTrack);
+      primaryTrack.SetID(thePool.GetNextTrackID());
+    }
+    thePoolCondition.notify_all();
+    theWorker(0, &theWS);
     //
-    // 4. Call the end of event action
+    // reduce the per-event buffers of the workers (none of them is tracking now)
+    for (Results& res : theWorkerResults) {
+      AddPerEventResults(theResult, res);
+      ResetPerEventResults(res);
+    }
+    HEPEMSHOW_PHASE_BEGIN(kPhaseEventEnd);
     EndOfEventAction(theResult, eventID);
+    HEPEMSHOW_PHASE_END(kPhaseEventEnd);
+    if (LiveMetrics::IsEnabled()) LiveMetrics::PublishEvent(theResult);
+    Timeline::End(Timeline::kEvent, eventID);
+    #ifdef HEPEMSHOW_ALLOC_TRACKING
+      // the allocations of the event: of this thread (including worker #0) and of the helpers
+      AllocTracker::EventSnapshot theEventAllocs = AllocTracker::EventSnapshot();
+      AllocTracker::Collect(theAllocSnapshot, theEventAllocs);
+      for (AllocTracker::EventSnapshot& allocs : theWorkerAllocs) {
+        AllocTracker::Add(allocs, theEventAllocs);
+        allocs = AllocTracker::EventSnapshot();
+      }
+      AllocTracker::AddEvent(theEventAllocs, theResult.fAllocStatistics, eventID);
+    #endif
+    HEPEMSHOW_PHASE_END(kPhaseEvent);
+    ++eventID;
     //
-    // increase the event ID (i.e. counter of simulated events)
-    ++eventID;;
-  };
+    // check the stopping rule (if any) at the batch boundaries
+    if (theStoppingRule && eventID % theStoppingRule->GetBatchSize() == 0 && theStoppingRule->Check(0, theResult)) {
+      break;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(thePoolMutex);
+    theRunDone = true;
+  }
+  thePoolCondition.notify_all();
+  for (auto& th : theHelpers) {
+    th.join();
+  }
+  #ifdef HEPEMSHOW_PHASE_TIMERS
+    CollectPhaseTimers(theWorkerResults[0].fPhaseTimers);
+  #endif
+  #ifdef HEPEMSHOW_STEP_STATISTICS
+    CollectStepStatistics(theWorkerResults[0].fStepStatistics);
+  #endif
+  //
+  // merge the track length histograms (and the instruments) of the workers
+  for (const Results& res : theWorkerResults) {
+    MergeResults(theResult, res);
+  }
+  theResult.fPeakTrackStackDepth = std::max(theResult.fPeakTrackStackDepth, thePool.GetPeakDepth());
   //
   // calculate and report the event processing time
   struct timeval finish;
   gettimeofday(&finish, NULL);
   const G4double theTime = ((G4double)(finish.tv_sec-start.tv_sec)*1000000 + (G4double)(finish.tv_usec-start.tv_usec)) / 1000000;
   if (verbosity > 0) {
-    std::cout << " --- EventLoop::ProcessEvents: completed simulation within t = " << theTime << " [s]" << std::endl;
+    std::cout << " --- EventLoop::ProcessEventsTrackParallel: completed simulation within t = " << theTime << " [s]" << std::endl;
+    if (theStoppingRule) theStoppingRule->Print(std::cout);
+  }
+  return eventID;
+}
+
+
+void EventLoop::ProcessOneEvent(G4HepEmTLData& theTLData, G4HepEmState& theState, PrimaryGenerator& thePrimaryGenerator, Geometry& theGeometry, Results& theResult, TrackStack& theTrackStack, int eventID, const PerfCounters* thePerfCounters) {
+  HEPEMSHOW_PHASE_SCOPE(kPhaseEvent);
+  Timeline::Begin(Timeline::kEvent);
+  #ifdef HEPEMSHOW_ALLOC_TRACKING
+    AllocTracker::EventSnapshot theAllocSnapshot;
+    AllocTracker::BeginEvent(theAllocSnapshot);
+  #endif
+  //
+  // 0. Reset the track ID before each new event such that it starts from zero again.
+  theTrackStack.ReSetTrackID();
+  //
+  // 1. Generate the primary track of this event:
+  // NOTE: each event is assumed to have one primary now just for simplicity
+  //       (no problem though with inserting more than one primary into the stack)
+  // - the primary track is the very first track in the stack, so obtain one
+  //   track reference from the stack and generate one primary into that
+  HEPEMSHOW_PHASE_BEGIN(kPhaseEventBegin);
+  G4HepEmTrack& primaryTrack = theTrackStack.Insert();
+
+  // 2. Invoke the beginning of event action (by passing the current primary track)
+  BeginOfEventAction(theResult, eventID, primaryTrack, theGeometry, thePrimaryGenerator);
+
+  // Continuation of 1.:
+  thePrimaryGenerator.GenerateOne(primaryTrack);
+  primaryTrack.SetID(theTrackStack.GetNextTrackID());
+  HEPEMSHOW_PHASE_END(kPhaseEventBegin);
+  //
+
+  //
+  //
+  // 3. While the track-stack becomes empty:
+  //   - pop-up one track (into the `HepEmTLData` primary electron/gamma track)
+  //   - track this particle till the end of its history in a step-by-step way
+  //     NOTE: secondaries are insterted into the track-stack after each step
+  //   Processing/simulation of this event is completed when the track-stack
+  //   becomes empty again
+  //   NOTE: `GetTypeOfNextTrack` returns -1, 0, +1 if the next track in the
+  //          stack is an e-, gamma or e+, while -999 in case of empty stack.
+  std::uint64_t thePerfStart[PerfCounterData::kNumCounters];
+  if (thePerfCounters) thePerfCounters->Read(thePerfStart);
+  int trackType = -1;
+  while ( (trackType = theTrackStack.GetTypeOfNextTrack()) > -2 ) {
+    HEPEMSHOW_PHASE_BEGIN(kPhaseTrackStack);
+    G4HepEmTrack* nextTrack = nullptr;
+    // depending if the next track is a gamma or e-/e+ track:
+    if (trackType == 0) { // the next track is a gamma
+      // - obtain the primary gamma track from the TL-data which the next track
+      //   from the stack will be popped into
+      G4HepEmGammaTrack* gTrack = theTLData.GetPrimaryGammaTrack();
+      // - perform the before "start-tracking" procedure: reset the track
+      //   properties and the random engine (throw away cached rnd number)
+      gTrack->ReSet();
+      theTLData.GetRNGEngine()->DiscardGauss();
+      // - get the common track part of this primary track
+      nextTrack = gTrack->GetTrack();
+    } else { // the next track is an e- or e+
+      // - obtain the primary electron track from the TL-data which the next track
+      //   from the stack will be popped into
+      G4HepEmElectronTrack* eTrack = theTLData.GetPrimaryElectronTrack();
+      // - perform the before "start-tracking" procedure: reset the track
+      //   properties and the random engine (throw away cached rnd number)
+      eTrack->ReSet();
+      theTLData.GetRNGEngine()->DiscardGauss();
+      // - get the common track part of this primary track
+      nextTrack = eTrack->GetTrack();
+    }
+    // - pop the next track from the stack into this
+    theTrackStack.PopInto(*nextTrack);
+    // - the simplified "navigation" assumes, that tracks start from inside
+    //   the `calorimeter` volume. This is true for secondary (ParentID > -1)
+    //   tracks by default as they are generated inside the calorimeter but
+    //   not for primary tracks (ParentID = -1) generated outside of the
+    //   calorimeter volume (in the vacuum, pointing to the calorimeter).
+    //   Therefore, primaries need to be moved to the calorimeter boundary
+    //   (as they point into the calorimeter they will be inside then).
+    if (nextTrack->GetParentID() < 0) {
+      G4double* pos = nextTrack->GetPosition();
+      pos[0] = theGeometry.GetCaloStartXposition();
+    }
+    // - invoke the beginning of tracking action before start tracking this track
+    BeginOfTrackingAction(theResult, *nextTrack);
+    HEPEMSHOW_PHASE_END(kPhaseTrackStack);
+    // - call the gamma/electron stepper to simulate the entire history of this
+    //   next-track (provided now in the primary gamma/electron track member of
+    //   the TL-data)
+    //   NOTE: the secondaries, generated during the simulation of the history
+    //         of this track, are all inserted into the track stack.
+    if (trackType == 0) { // the next track is a gamma
+      SteppingLoop::GammaStepper(theTLData, theState, theTrackStack, theGeometry, theResult, eventID);
+    } else {              // the next track is an e- or e+
+      SteppingLoop::ElectronStepper(theTLData, theState, theTrackStack, theGeometry, theResult, eventID);
+    }
+    // - invoke the end of tracking action when the end of its simulation history is reached
+    EndOfTrackingAction(theResult, *nextTrack);
+  };
+  //
+  if (thePerfCounters) {
+    thePerfCounters->Accumulate(theResult.fPerfCounterData, PerfCounterData::kTransport, thePerfStart);
+    thePerfCounters->Read(thePerfStart);
   }
+  //
+  // 4. Call the end of event action
+  HEPEMSHOW_PHASE_BEGIN(kPhaseEventEnd);
+  EndOfEventAction(theResult, eventID);
+  HEPEMSHOW_PHASE_END(kPhaseEventEnd);
+  if (thePerfCounters) thePerfCounters->Accumulate(theResult.fPerfCounterData, PerfCounterData::kEndOfEvent, thePerfStart);
+  if (LiveMetrics::IsEnabled()) LiveMetrics::PublishEvent(theResult);
+  Timeline::End(Timeline::kEvent, eventID);
+  #ifdef HEPEMSHOW_ALLOC_TRACKING
+    AllocTracker::EndEvent(theAllocSnapshot, theResult.fAllocStatistics, eventID);
+  #endif
 }
 
 
@@ -158,6 +779,7 @@ void EventLoop::BeginOfEventAction(Results& theResult, int eventID, const G4HepE
   // reset all per-event accumulators in results, i.e. that are used to accumulate data during one event
 
   #ifdef CODI_REVERSE
+  if (theResult.fComputeDerivatives) {
     G4double::getTape().reset();
     G4double::getTape().setActive();
     theResult.pThicknessAbsorber = theGeometry.GetAbsThick();
@@ -169,8 +791,13 @@ void EventLoop::BeginOfEventAction(Results& theResult, int eventID, const G4HepE
     theResult.pParticleEnergy = thePrimaryGenerator.GetKinEnergy();
     G4double::getTape().registerInput(theResult.pParticleEnergy);
     thePrimaryGenerator.SetKinEnergy(theResult.pParticleEnergy);
+  }
   #endif
 
+  ResetPerEventResults(theResult);
+}
+
+void EventLoop::ResetPerEventResults(Results& theResult) {
   theResult.fPerEventRes.fEdepAbs        = 0.0;
   theResult.fPerEventRes.fEdepGap        = 0.0;
 
@@ -181,10 +808,23 @@ void EventLoop::BeginOfEventAction(Results& theResult, int eventID, const G4HepE
   theResult.fPerEventRes.fNumStepsGamma  = 0.0;
   theResult.fPerEventRes.fNumStepsElPos  = 0.0;
 
-  for(int i=0; i<50; i++){
-    theResult.fEdepPerLayer_CurrentEvent.GetY()[i] = 0.;
+  for(G4double& edep : theResult.fEdepPerLayer_CurrentEvent.GetY()){
+    edep = 0.;
   }
+}
+
+void EventLoop::AddPerEventResults(Results& to, const Results& from) {
+  to.fPerEventRes.fEdepAbs        += from.fPerEventRes.fEdepAbs;
+  to.fPerEventRes.fEdepGap        += from.fPerEventRes.fEdepGap;
+
+  to.fPerEventRes.fNumSecGamma    += from.fPerEventRes.fNumSecGamma;
+  to.fPerEventRes.fNumSecElectron += from.fPerEventRes.fNumSecElectron;
+  to.fPerEventRes.fNumSecPositron += from.fPerEventRes.fNumSecPositron;
 
+  to.fPerEventRes.fNumStepsGamma  += from.fPerEventRes.fNumStepsGamma;
+  to.fPerEventRes.fNumStepsElPos  += from.fPerEventRes.fNumStepsElPos;
+
+  to.fEdepPerLayer_CurrentEvent.Add(&from.fEdepPerLayer_CurrentEvent);
 }
 
 void EventLoop::EndOfEventAction(Results& theResult, int eventID) {
@@ -194,10 +834,13 @@ void EventLoop::EndOfEventAction(Results& theResult, int eventID) {
   theResult.fEdepAbs2 += dum*dum;
 
   theResult.fEdepPerLayer.Add(&theResult.fEdepPerLayer_CurrentEvent);
-  for(int i=0; i<50; i++){
+  const int numLayers = theResult.fEdepPerLayer_CurrentEvent.GetNumBins();
+  for(int i=0; i<numLayers; i++){
     theResult.fEdepPerLayer_Acc[i].add(GET_VALUE((theResult.fEdepPerLayer_CurrentEvent.GetY()[i])));
     #if CODI_FORWARD
+    if (theResult.fComputeDerivatives) {
        theResult.fEdepPerLayer_AccD[i].add(GET_DOTVALUE((theResult.fEdepPerLayer_CurrentEvent.GetY()[i])));
+    }
     #endif
   }
 
@@ -228,22 +871,31 @@ void EventLoop::EndOfEventAction(Results& theResult, int eventID) {
   theResult.fNumStepsElPos2 += dum*dum;
 
   #ifdef CODI_REVERSE
-    for(int i=0; i<50; i++){
+  if (theResult.fComputeDerivatives) {
+    for(int i=0; i<numLayers; i++){
        G4double::getTape().registerOutput(theResult.fEdepPerLayer_CurrentEvent.GetY()[i]);
     }
     G4double::getTape().setPassive();
-    for(int i=0; i<50; i++){
+    theResult.fTapeBytesPerEvent.add( G4double::getTape().getTapeValues().getUsedMemory() );
+    for(int i=0; i<numLayers; i++){
        theResult.fEdepPerLayer_CurrentEvent.GetY()[i].setGradient(theResult.barEdep[i]);
     }
+    const auto revStart = std::chrono::steady_clock::now();
     G4double::getTape().evaluate();
+    theResult.fReverseTimePerEvent.add( std::chrono::duration<double>(std::chrono::steady_clock::now() - revStart).count() );
     theResult.barThicknessAbsorber.add( theResult.pThicknessAbsorber.getGradient() );
     theResult.barThicknessGap.add( theResult.pThicknessGap.getGradient() );
     theResult.barParticleEnergy.add( theResult.pParticleEnergy.getGradient() );
+  }
   #endif
 }
 
 
 void EventLoop::BeginOfTrackingAction(Results& theResult, G4HepEmTrack& theTrack) {
+  // start the span of this track on the timeline (if the tracks are recorded)
+  if (Timeline::IsTracksEnabled()) {
+    Timeline::Begin(Timeline::kTrack);
+  }
   // check if this track is a secondary (parent ID > -1) then its type (based on the charge)
   if (theTrack.GetParentID() > -1) {
     const int ich = GET_VALUE(theTrack.GetCharge());
@@ -259,6 +911,10 @@ void EventLoop::BeginOfTrackingAction(Results& theResult, G4HepEmTrack& theTrack
 }
 
 
-void EventLoop::EndOfTrackingAction(Results& /*theResult*/, G4HepEmTrack& /*theTrack*/) {
-  // we do nothing here now (but we could of course)
+void EventLoop::EndOfTrackingAction(Results& /*theResult*/, G4HepEmTrack& theTrack) {
+  // record the span of this track on the timeline (if the tracks are recorded)
+  if (Timeline::IsTracksEnabled()) {
+    const int ich = GET_VALUE(theTrack.GetCharge());
+    Timeline::End(Timeline::kTrack, theTrack.GetID(), ich == 0 ? 0 : (ich < 0 ? 1 : 2));
+  }
 }
@@ -0,0 +1,87 @@
+#include "ad_type.h"
+
+
+#include "EventRecord.hh"
+
+#include "URandom.hh"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <random>
+
+
+std::vector<EventRecord> CreateEventRecords(int numEvents, std::uint64_t runSeed) {
+  std::vector<EventRecord> records(std::max(0, numEvents));
+  for (int i = 0; i < numEvents; ++i) {
+    records[i].fEventID = i;
+    records[i].fSeed    = URandom::EventSeed(runSeed, i);
+  }
+  return records;
+}
+
+
+void WriteEventRecords(const std::string& fileName, const std::vector<EventRecord>& records) {
+  std::ofstream os(fileName);
+  if (!os) {
+    std::cerr << "\n ***** ERROR in WriteEventRecords  "
+              << " cannot create the file = " << fileName
+              << std::endl;
+    exit(1);
+  }
+  os << "# eventID seed edep[MeV] numSteps time[s]\n";
+  os << std::setprecision(14);
+  for (const EventRecord& rec : records) {
+    os << rec.fEventID << " " << rec.fSeed << " " << rec.fEdep << " " << rec.fNumSteps << " " << rec.fTime << "\n";
+  }
+}
+
+
+std::vector<EventRecord> ReadEventRecords(const std::string& fileName) {
+  std::ifstream is(fileName);
+  if (!is) {
+    std::cerr << "\n ***** ERROR in ReadEventRecords  "
+              << " cannot open the file = " << fileName
+              << std::endl;
+    exit(1);
+  }
+  std::vector<EventRecord> records;
+  std::string line;
+  while (std::getline(is, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream ss(line);
+    EventRecord rec;
+    if (ss >> rec.fEventID >> rec.fSeed >> rec.fEdep >> rec.fNumSteps >> rec.fTime) {
+      records.push_back(rec);
+    }
+  }
+  return records;
+}
+
+
+std::vector<EventRecord> SelectEventRecords(const std::vector<EventRecord>& records, const std::string& selection, std::uint64_t seed) {
+  if (selection == "all") {
+    return records;
+  }
+  const size_t sep = selection.find(':');
+  const std::string kind = selection.substr(0, sep);
+  if (sep == std::string::npos || !(kind == "random" || kind == "top")) {
+    std::cerr << "\n ***** ERROR in SelectEventRecords  "
+              << " unknown event selection = " << selection << " (all, random:K or top:K)"
+              << std::endl;
+    exit(1);
+  }
+  const size_t numSelect = std::min(records.size(), (size_t)std::stoul(selection.substr(sep+1)));
+  std::vector<EventRecord> selected(records);
+  if (kind == "random") {
+    std::mt19937_64 engine(seed);
+    std::shuffle(selected.begin(), selected.end(), engine);
+  } else {
+    std::stable_sort(selected.begin(), selected.end(), [](const EventRecord& a, const EventRecord& b) { return a.fEdep > b.fEdep; });
+  }
+  selected.resize(numSelect);
+  std::sort(selected.begin(), selected.end(), [](const EventRecord& a, const EventRecord& b) { return a.fEventID < b.fEventID; });
+  return selected;
+}
@@ -0,0 +1,111 @@
+#include "ad_type.h"
+
+
+#include "FiniteDifference.hh"
+
+#include "Results.hh"
+#include "Geometry.hh"
+#include "PrimaryGenerator.hh"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+
+
+FiniteDifference::FiniteDifference(EParameter parameter, double step)
+: fParameter(parameter),
+  fStep(step) {}
+
+
+bool FiniteDifference::ParameterByName(const std::string& name, EParameter& parameter) {
+  if (name == "abs") {
+    parameter = kAbsorberThickness;
+  } else if (name == "gap") {
+    parameter = kGapThickness;
+  } else if (name == "energy") {
+    parameter = kParticleEnergy;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+void FiniteDifference::Perturb(Geometry& theGeometry, PrimaryGenerator& thePrimaryGenerator, double sign) const {
+  switch (fParameter) {
+    case kAbsorberThickness:
+      theGeometry.SetAbsThick(theGeometry.GetAbsThick() + sign*fStep);
+      break;
+    case kGapThickness:
+      theGeometry.SetGapThick(theGeometry.GetGapThick() + sign*fStep);
+      break;
+    case kParticleEnergy:
+      thePrimaryGenerator.SetKinEnergy(thePrimaryGenerator.GetKinEnergy() + sign*fStep);
+      break;
+  }
+  // the primary starts in front of the (perturbed) calorimeter
+  thePrimaryGenerator.SetPosition(theGeometry.GetPrimaryXposition(), 0.0, 0.0);
+}
+
+
+void FiniteDifference::Init(int numLayers) {
+  fDiff.assign(numLayers, Accumulator<double>());
+  fPlus.assign(numLayers, Accumulator<double>());
+  fMinus.assign(numLayers, Accumulator<double>());
+  fDiffAbs  = Accumulator<double>();
+  fPlusAbs  = Accumulator<double>();
+  fMinusAbs = Accumulator<double>();
+}
+
+
+void FiniteDifference::AddEvent(const Results& thePlusResult, const Results& theMinusResult) {
+  const std::vector<G4double>& plus  = thePlusResult.fEdepPerLayer_CurrentEvent.GetY();
+  const std::vector<G4double>& minus = theMinusResult.fEdepPerLayer_CurrentEvent.GetY();
+  const double invStep = 0.5/fStep;
+  for (std::size_t i = 0; i < fDiff.size(); ++i) {
+    const double ep = GET_VALUE(plus[i]);
+    const double em = GET_VALUE(minus[i]);
+    fDiff[i].add((ep - em)*invStep);
+    fPlus[i].add(ep);
+    fMinus[i].add(em);
+  }
+  const double ep = GET_VALUE(thePlusResult.fPerEventRes.fEdepAbs);
+  const double em = GET_VALUE(theMinusResult.fPerEventRes.fEdepAbs);
+  fDiffAbs.add((ep - em)*invStep);
+  fPlusAbs.add(ep);
+  fMinusAbs.add(em);
+}
+
+
+void FiniteDifference::Write(const std::string& fileName, std::ostream& os) const {
+  // variance of the difference quotient of two independent runs
+  const double norm = 0.25/(fStep*fStep);
+  std::ofstream fd(fileName);
+  if (!fd) {
+    std::cerr << "\n ***** ERROR in FiniteDifference::Write  "
+              << " cannot create the file = " << fileName
+              << std::endl;
+    exit(1);
+  }
+  fd << std::setprecision(14);
+  for (std::size_t i = 0; i < fDiff.size(); ++i) {
+    fd << fDiff[i].getMean() << " " << fDiff[i].getVar() << " " << (fPlus[i].getVar() + fMinus[i].getVar())*norm << "\n";
+  }
+  fd.close();
+  //
+  static const char* names[3]  = { "absorber thickness", "gap thickness", "primary energy" };
+  static const char* units[3]  = { "[mm]", "[mm]", "[MeV]" };
+  const double numEvents = static_cast<double>(fDiffAbs.getCount());
+  const double varCRN    = std::max(0.0, fDiffAbs.getVar());
+  const double varIndep  = (std::max(0.0, fPlusAbs.getVar()) + std::max(0.0, fMinusAbs.getVar()))*norm;
+  os << std::setprecision(6);
+  os << " --- FiniteDifference: central differences of the " << names[fParameter] << " with h = " << fStep << " " << units[fParameter]
+     << " (per layer in " << fileName << ")" << std::endl;
+  os << "     d(absorber Edep)/d(" << names[fParameter] << ") = " << fDiffAbs.getMean() << " +- "
+     << (numEvents > 1 ? std::sqrt(varCRN/numEvents) : 0.0) << " [MeV/" << (fParameter == kParticleEnergy ? "MeV" : "mm") << "]" << std::endl;
+  os << "     variance per event: " << varCRN << " (common random numbers) vs. " << varIndep
+     << " (independent runs), reduction factor: " << (varCRN > 0.0 ? varIndep/varCRN : 0.0) << std::endl;
+  os << " ------------------------------------------------------------" << std::endl;
+}
@@ -4,8 +4,10 @@
 #include "Geometry.hh"
 
 #include "Box.hh"
+#include "NavAdjoints.hh"
 
 #include <iostream>
+#include <algorithm>
 
 Geometry::Geometry() {
   // default values: 50 layers of 2.3 [mm] absorber (PbWO4) and 5.7 [mm] gap (lAr)
@@ -32,6 +34,24 @@ Geometry::Geometry() {
 }
 
 
+Geometry::Geometry(const Geometry& other)
+: fNumLayers(other.fNumLayers),
+  fAbsThick(other.fAbsThick),
+  fGapThick(other.fGapThick),
+  fLayerThick(other.fLayerThick),
+  fCaloThick(other.fCaloThick),
+  fCaloSizeYZ(other.fCaloSizeYZ),
+  fCaloStartX(other.fCaloStartX),
+  fPrimaryXPosition(other.fPrimaryXPosition) {
+  // each geometry has its own box shape objects
+  fBoxWorld  = new Box(*other.fBoxWorld);
+  fBoxCalo   = new Box(*other.fBoxCalo);
+  fBoxLayer  = new Box(*other.fBoxLayer);
+  fBoxAbs    = new Box(*other.fBoxAbs);
+  fBoxGap    = new Box(*other.fBoxGap);
+}
+
+
 Geometry::~Geometry() {
   delete fBoxWorld;
   delete fBoxCalo;
@@ -82,6 +102,15 @@ void Geometry::UpdateParameters() {
 }
 
 
+std::vector<int> Geometry::GetMaterialIndices() const {
+  std::vector<int> indices = { fBoxWorld->GetMaterialIndx(), fBoxCalo->GetMaterialIndx(), fBoxLayer->GetMaterialIndx(),
+                               fBoxAbs->GetMaterialIndx(), fBoxGap->GetMaterialIndx() };
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+  return indices;
+}
+
+
 // note: try to keep this more verbose than fast to keep it clear
 G4double Geometry::CalculateDistanceToOut(G4double* r, G4double *v, Box** currentVolume, int* indxLayer, int* indxAbs) {
   // init everything to a step in the `world` case
@@ -105,8 +134,19 @@ G4double Geometry::CalculateDistanceToOut(G4double* r, G4double *v, Box** curren
   const int iLayer = int( GET_VALUE(((rx_Calo+0.5*fCaloThick)/fLayerThick)) );
   *indxLayer = iLayer;
   // - then the corresponding translation vector and transform the point
+#ifdef HEPEMSHOW_USE_NAV_ADJOINTS
+  // a single statement on the tape (see `NavAdjoints.hh`)
+  G4double rx_Layer;
+  {
+    const double trLayeri = -0.5*GET_VALUE(fCaloThick) + (iLayer+0.5)*GET_VALUE(fLayerThick);
+    const G4double* const args[3] = { &rx_Calo, &fCaloThick, &fLayerThick };
+    const double jacobians[3]     = { 1.0, 0.5, -(iLayer+0.5) };
+    SetWithPartials(rx_Layer, GET_VALUE(rx_Calo) - trLayeri, args, jacobians);
+  }
+#else
   const G4double trLayeri = -0.5*fCaloThick + (iLayer+0.5)*fLayerThick;
   const G4double rx_Layer = rx_Calo - trLayeri;
+#endif
   r[0] =  rx_Layer;
 
   // calculate the distance to the `layer` boundary along the given direction
@@ -121,8 +161,17 @@ G4double Geometry::CalculateDistanceToOut(G4double* r, G4double *v, Box** curren
   if (rx_Layer + 0.5*fLayerThick < fAbsThick || fGapThick == 0) { // in the `absorber`
     // calculate the position in the `absorber` system:
     // - the translation vector and transform the point
+#ifdef HEPEMSHOW_USE_NAV_ADJOINTS
+    {
+      const double trAbs = -0.5*(GET_VALUE(fLayerThick) - GET_VALUE(fAbsThick));
+      const G4double* const args[3] = { &rx_Layer, &fLayerThick, &fAbsThick };
+      const double jacobians[3]     = { 1.0, 0.5, -0.5 };
+      SetWithPartials(r[0], GET_VALUE(rx_Layer) - trAbs, args, jacobians);
+    }
+#else
     const G4double trAbs = -0.5*(fLayerThick - fAbsThick);
     r[0] = rx_Layer - trAbs;
+#endif
     // set what is left and calculate the distance to the `absorber` boundary along
     // the given direction (again, I could push here and do recursion whenever it's zero)
     *currentVolume = fBoxAbs;
@@ -131,8 +180,17 @@ G4double Geometry::CalculateDistanceToOut(G4double* r, G4double *v, Box** curren
   } else { // in the `gap`
     // calculate the position in the `gap` system:
     // - the translation vector and transform the point
+#ifdef HEPEMSHOW_USE_NAV_ADJOINTS
+    {
+      const double trGap = -0.5*(GET_VALUE(fLayerThick) - GET_VALUE(fGapThick)) + GET_VALUE(fAbsThick);
+      const G4double* const args[4] = { &rx_Layer, &fLayerThick, &fGapThick, &fAbsThick };
+      const double jacobians[4]     = { 1.0, 0.5, -0.5, -1.0 };
+      SetWithPartials(r[0], GET_VALUE(rx_Layer) - trGap, args, jacobians);
+    }
+#else
     const G4double  trGap = -0.5*(fLayerThick -fGapThick) + fAbsThick;
     r[0] = rx_Layer - trGap;
+#endif
     // set what is left and calculate the distance to the `gap` boundary along
     // the given direction (again, I could push here and do recursion whenever it's zero)
     *currentVolume = fBoxGap;
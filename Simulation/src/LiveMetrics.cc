@@ -0,0 +1,238 @@
+#include "ad_type.h"
+
+
+#include "LiveMetrics.hh"
+
+#include "Results.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+bool LiveMetrics::gEnabled = false;
+
+namespace {
+  // the slot of one publishing thread: written only by its thread (relaxed
+  // atomic load/store pairs, i.e. no read-modify-write) and read by the monitor
+  // (padded to avoid false sharing between the slots of the threads)
+  struct Slot {
+    std::atomic<std::uint64_t>       fNumEvents{0};
+    std::atomic<double>              fNumStepsGamma{0.0};
+    std::atomic<double>              fNumStepsElPos{0.0};
+    std::vector<std::atomic<double>> fEdepSum;   // per layer
+    std::vector<std::atomic<double>> fEdepSum2;  // per layer
+    char                             fPadding[64];
+  };
+
+  // the sum of the slots
+  struct Snapshot {
+    double              fNumEvents{0.0};
+    double              fNumStepsGamma{0.0};
+    double              fNumStepsElPos{0.0};
+    std::vector<double> fEdepSum;
+    std::vector<double> fEdepSum2;
+  };
+
+  std::string                           gFileName;
+  double                                gPeriod{10.0};
+  std::atomic<int>                      gNumEventsTotal{0};
+  int                                   gNumLayers{0};
+  std::unique_ptr<Slot[]>               gSlots;
+  int                                   gNumSlots{0};
+  std::atomic<int>                      gNextSlot{0};
+  thread_local int                      tSlot = -1;
+  std::chrono::steady_clock::time_point gStart;
+
+  std::thread                           gMonitor;
+  std::mutex                            gMutex;
+  std::condition_variable               gStopCV;
+  bool                                  gStop{false};
+
+  volatile std::sig_atomic_t            gDumpRequested = 0;
+  void                                (*gPreviousHandler)(int) = SIG_DFL;
+
+  void HandleSIGUSR1(int) {
+    gDumpRequested = 1;
+  }
+
+  inline void AddRelaxed(std::atomic<double>& val, double x) {
+    val.store(val.load(std::memory_order_relaxed) + x, std::memory_order_relaxed);
+  }
+
+  Snapshot TakeSnapshot() {
+    Snapshot snap;
+    snap.fEdepSum.resize(gNumLayers, 0.0);
+    snap.fEdepSum2.resize(gNumLayers, 0.0);
+    for (int is = 0; is < gNumSlots; ++is) {
+      const Slot& slot = gSlots[is];
+      snap.fNumEvents     += slot.fNumEvents.load(std::memory_order_acquire);
+      snap.fNumStepsGamma += slot.fNumStepsGamma.load(std::memory_order_relaxed);
+      snap.fNumStepsElPos += slot.fNumStepsElPos.load(std::memory_order_relaxed);
+      for (int il = 0; il < gNumLayers; ++il) {
+        snap.fEdepSum[il]  += slot.fEdepSum[il].load(std::memory_order_relaxed);
+        snap.fEdepSum2[il] += slot.fEdepSum2[il].load(std::memory_order_relaxed);
+      }
+    }
+    return snap;
+  }
+
+  // mean energy deposit (per event) in the given layer and its relative error
+  void LayerMean(const Snapshot& snap, int il, double& mean, double& relErr) {
+    const double n = snap.fNumEvents;
+    mean   = n > 0.0 ? snap.fEdepSum[il]/n : 0.0;
+    relErr = 0.0;
+    if (n > 1.0 && mean > 0.0) {
+      const double var = std::max(0.0, snap.fEdepSum2[il]/n - mean*mean);
+      relErr = std::sqrt(var/(n-1.0))/mean;
+    }
+  }
+
+  void WriteSnapshot(const Snapshot& snap, double elapsed) {
+    const std::string tmpName = gFileName + ".tmp";
+    FILE* f = fopen(tmpName.c_str(), "w");
+    if (!f) {
+      std::cerr << " *** LiveMetrics: cannot create the file = " << tmpName << std::endl;
+      return;
+    }
+    const double total = gNumEventsTotal.load();
+    const double rate  = elapsed > 0.0 ? snap.fNumEvents/elapsed : 0.0;
+    const double eta   = rate > 0.0 ? std::max(0.0, total - snap.fNumEvents)/rate : -1.0;
+    fprintf(f, "# HELP hepemshow_events_done Number of completed events.\n# TYPE hepemshow_events_done counter\n");
+    fprintf(f, "hepemshow_events_done %.0f\n", snap.fNumEvents);
+    fprintf(f, "# HELP hepemshow_events_total Number of events to simulate.\n# TYPE hepemshow_events_total gauge\n");
+    fprintf(f, "hepemshow_events_total %.0f\n", total);
+    fprintf(f, "# HELP hepemshow_elapsed_seconds Time since the start of the event loop.\n# TYPE hepemshow_elapsed_seconds gauge\n");
+    fprintf(f, "hepemshow_elapsed_seconds %.3f\n", elapsed);
+    fprintf(f, "# HELP hepemshow_events_per_second Mean event throughput.\n# TYPE hepemshow_events_per_second gauge\n");
+    fprintf(f, "hepemshow_events_per_second %g\n", rate);
+    fprintf(f, "# HELP hepemshow_eta_seconds Estimated time till the end of the event loop (-1 if unknown).\n# TYPE hepemshow_eta_seconds gauge\n");
+    fprintf(f, "hepemshow_eta_seconds %.3f\n", eta);
+    fprintf(f, "# HELP hepemshow_steps_per_second Mean step throughput.\n# TYPE hepemshow_steps_per_second gauge\n");
+    fprintf(f, "hepemshow_steps_per_second{particle=\"gamma\"} %g\n", elapsed > 0.0 ? snap.fNumStepsGamma/elapsed : 0.0);
+    fprintf(f, "hepemshow_steps_per_second{particle=\"e-/e+\"} %g\n", elapsed > 0.0 ? snap.fNumStepsElPos/elapsed : 0.0);
+    fprintf(f, "# HELP hepemshow_edep_layer_mean_mev Mean energy deposit per event in the layer.\n# TYPE hepemshow_edep_layer_mean_mev gauge\n");
+    for (int il = 0; il < gNumLayers; ++il) {
+      double mean, relErr;
+      LayerMean(snap, il, mean, relErr);
+      fprintf(f, "hepemshow_edep_layer_mean_mev{layer=\"%d\"} %g\n", il, mean);
+    }
+    fprintf(f, "# HELP hepemshow_edep_layer_rel_error Relative error of the mean energy deposit in the layer.\n# TYPE hepemshow_edep_layer_rel_error gauge\n");
+    for (int il = 0; il < gNumLayers; ++il) {
+      double mean, relErr;
+      LayerMean(snap, il, mean, relErr);
+      fprintf(f, "hepemshow_edep_layer_rel_error{layer=\"%d\"} %g\n", il, relErr);
+    }
+    fclose(f);
+    std::rename(tmpName.c_str(), gFileName.c_str());
+  }
+
+  void PrintSnapshot(const Snapshot& snap, double elapsed) {
+    const double total = gNumEventsTotal.load();
+    const double rate  = elapsed > 0.0 ? snap.fNumEvents/elapsed : 0.0;
+    std::cout << " --- LiveMetrics: intermediate results -------------------- " << std::endl;
+    std::cout << std::setprecision(6)
+              << "  events done: " << snap.fNumEvents << " of " << total << " in " << elapsed << " [s] ("
+              << rate << " events/s, ETA: " << (rate > 0.0 ? std::max(0.0, total - snap.fNumEvents)/rate : -1.0) << " [s])" << std::endl;
+    std::cout << "  layer   mean Edep [MeV]   rel. error" << std::endl;
+    for (int il = 0; il < gNumLayers; ++il) {
+      double mean, relErr;
+      LayerMean(snap, il, mean, relErr);
+      std::cout << "  " << std::setw(5) << il << std::setw(18) << mean << std::setw(13) << relErr << std::endl;
+    }
+    std::cout << " ------------------------------------------------------------" << std::endl;
+  }
+
+  void Monitor() {
+    auto lastWrite = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(gMutex);
+    while (!gStop) {
+      // wake up regularly to react to `SIGUSR1` fast
+      gStopCV.wait_for(lock, std::chrono::milliseconds(100));
+      const auto now = std::chrono::steady_clock::now();
+      const double elapsed = std::chrono::duration<double>(now - gStart).count();
+      if (gDumpRequested) {
+        gDumpRequested = 0;
+        PrintSnapshot(TakeSnapshot(), elapsed);
+      }
+      if (gStop || std::chrono::duration<double>(now - lastWrite).count() >= gPeriod) {
+        WriteSnapshot(TakeSnapshot(), elapsed);
+        lastWrite = now;
+      }
+    }
+  }
+}
+
+
+void LiveMetrics::Start(const std::string& fileName, double period, int numEventsTotal, int numLayers, int numThreads) {
+  gFileName  = fileName;
+  gPeriod    = period > 0.0 ? period : 10.0;
+  gNumEventsTotal.store(numEventsTotal);
+  gNumLayers = numLayers;
+  gNumSlots  = std::max(1, numThreads);
+  gSlots.reset(new Slot[gNumSlots]);
+  for (int is = 0; is < gNumSlots; ++is) {
+    gSlots[is].fEdepSum  = std::vector<std::atomic<double>>(gNumLayers);
+    gSlots[is].fEdepSum2 = std::vector<std::atomic<double>>(gNumLayers);
+  }
+  gNextSlot.store(0);
+  gStart     = std::chrono::steady_clock::now();
+  gStop      = false;
+  gEnabled   = true;
+  gPreviousHandler = std::signal(SIGUSR1, HandleSIGUSR1);
+  gMonitor   = std::thread(Monitor);
+}
+
+
+void LiveMetrics::Stop() {
+  if (!gEnabled) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(gMutex);
+    gStop = true;
+  }
+  gStopCV.notify_one();
+  gMonitor.join();
+  std::signal(SIGUSR1, gPreviousHandler == SIG_ERR ? SIG_DFL : gPreviousHandler);
+  gEnabled = false;
+}
+
+
+void LiveMetrics::SetNumEventsTotal(int numEventsTotal) {
+  gNumEventsTotal.store(numEventsTotal);
+}
+
+
+void LiveMetrics::PublishEvent(const Results& res) {
+  if (tSlot < 0) {
+    tSlot = gNextSlot.fetch_add(1);
+  }
+  // more publishing threads than slots: not published
+  if (tSlot >= gNumSlots) {
+    return;
+  }
+  Slot& slot = gSlots[tSlot];
+  const std::vector<G4double>& edeps = res.fEdepPerLayer_CurrentEvent.GetY();
+  const int numLayers = std::min<int>(gNumLayers, edeps.size());
+  for (int il = 0; il < numLayers; ++il) {
+    const double edep = GET_VALUE(edeps[il]);
+    AddRelaxed(slot.fEdepSum[il], edep);
+    AddRelaxed(slot.fEdepSum2[il], edep*edep);
+  }
+  AddRelaxed(slot.fNumStepsGamma, GET_VALUE(res.fPerEventRes.fNumStepsGamma));
+  AddRelaxed(slot.fNumStepsElPos, GET_VALUE(res.fPerEventRes.fNumStepsElPos));
+  // the event is completed: release all the above
+  slot.fNumEvents.store(slot.fNumEvents.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
@@ -0,0 +1,139 @@
+#include "ad_type.h"
+
+
+#include "MultiLevelMC.hh"
+
+#include "Results.hh"
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+
+MultiLevelMC::MultiLevelMC(int numLevels, int numLayers)
+: fLevels(std::max(1, numLevels)) {
+  for (Level& level : fLevels) {
+    level.fDiff.resize(numLayers);
+    level.fFine.resize(numLayers);
+  }
+}
+
+
+void MultiLevelMC::AddEvent(int level, const Results& theFineResult, const Results* theCoarseResult, double fineTime, double coarseTime) {
+  Level& lev = fLevels[level];
+  const std::vector<G4double>& fine = theFineResult.fEdepPerLayer_CurrentEvent.GetY();
+  for (std::size_t i = 0; i < lev.fDiff.size(); ++i) {
+    const double ef = GET_VALUE(fine[i]);
+    const double ec = theCoarseResult != nullptr ? GET_VALUE(theCoarseResult->fEdepPerLayer_CurrentEvent.GetY()[i]) : 0.0;
+    lev.fDiff[i].add(ef - ec);
+    lev.fFine[i].add(ef);
+  }
+  lev.fCost.add(fineTime + coarseTime);
+  lev.fFineCost.add(fineTime);
+}
+
+
+int MultiLevelMC::GetNumEvents(int level) const {
+  return static_cast<int>(fLevels[level].fCost.getCount());
+}
+
+
+double MultiLevelMC::GetVariance(int level) const {
+  double var = 0.0;
+  if (GetNumEvents(level) > 1) {
+    for (const Accumulator<double>& acc : fLevels[level].fDiff) {
+      var += std::max(0.0, acc.getVar());
+    }
+  }
+  return var;
+}
+
+
+double MultiLevelMC::GetCost(int level) const {
+  return GetNumEvents(level) > 0 ? fLevels[level].fCost.getMean() : 0.0;
+}
+
+
+void MultiLevelMC::Estimate(int layer, double& mean, double& variance) const {
+  mean     = 0.0;
+  variance = 0.0;
+  for (const Level& lev : fLevels) {
+    const double n = static_cast<double>(lev.fCost.getCount());
+    if (n > 0) {
+      mean     += lev.fDiff[layer].getMean();
+      variance += std::max(0.0, lev.fDiff[layer].getVar())/n;
+    }
+  }
+}
+
+
+double MultiLevelMC::TargetVariance(double relError) const {
+  double norm2 = 0.0;
+  for (std::size_t i = 0; i < fLevels[0].fDiff.size(); ++i) {
+    double mean, variance;
+    Estimate(i, mean, variance);
+    norm2 += mean*mean;
+  }
+  return relError*relError*norm2;
+}
+
+
+std::vector<int> MultiLevelMC::OptimalNumEvents(double targetVariance) const {
+  double sum = 0.0;
+  for (int l = 0; l < GetNumLevels(); ++l) {
+    sum += std::sqrt(GetVariance(l)*GetCost(l));
+  }
+  std::vector<int> numEvents(GetNumLevels(), 0);
+  for (int l = 0; l < GetNumLevels(); ++l) {
+    const double cost = GetCost(l);
+    const double num  = targetVariance > 0.0 && cost > 0.0 ? std::ceil(std::sqrt(GetVariance(l)/cost)*sum/targetVariance) : 0.0;
+    numEvents[l] = static_cast<int>(std::min(num, static_cast<double>(std::numeric_limits<int>::max())));
+  }
+  return numEvents;
+}
+
+
+void MultiLevelMC::Write(const std::string& fileName, std::ostream& os, double targetVariance) const {
+  std::ofstream edeps(fileName);
+  if (!edeps) {
+    std::cerr << "\n ***** ERROR in MultiLevelMC::Write  "
+              << " cannot create the file = " << fileName
+              << std::endl;
+    exit(1);
+  }
+  edeps << std::setprecision(14);
+  double variance = 0.0;
+  for (std::size_t i = 0; i < fLevels[0].fDiff.size(); ++i) {
+    double mean, var;
+    Estimate(i, mean, var);
+    edeps << mean << " " << std::sqrt(var) << "\n";
+    variance += var;
+  }
+  edeps.close();
+  //
+  // the cost of the same variance with events of the finest level only
+  const Level& finest   = fLevels.back();
+  double fineVariance = 0.0;
+  for (const Accumulator<double>& acc : finest.fFine) {
+    fineVariance += std::max(0.0, acc.getVar());
+  }
+  const double fineCost = finest.fFineCost.getCount() > 0 ? finest.fFineCost.getMean() : 0.0;
+  double cost = 0.0;
+  os << " --- MultiLevelMC: estimates of the mean energy deposit per layer in " << fileName << std::endl;
+  os << "  level     events   variance/event     cost/event [s]" << std::endl;
+  os << std::setprecision(6);
+  for (int l = 0; l < GetNumLevels(); ++l) {
+    os << "  " << std::setw(5) << l << std::setw(11) << GetNumEvents(l) << std::setw(17) << GetVariance(l)
+       << std::setw(19) << GetCost(l) << std::endl;
+    cost += GetNumEvents(l)*GetCost(l);
+  }
+  const double target = targetVariance > 0.0 ? targetVariance : variance;
+  const double fineOnlyCost = target > 0.0 ? fineVariance/target*fineCost : 0.0;
+  os << "  variance of the estimates: " << variance << " (target: " << targetVariance << ")" << std::endl;
+  os << "  cost: " << cost << " [s] vs. " << fineOnlyCost << " [s] with events of the finest level only (saving factor: "
+     << (cost > 0.0 ? fineOnlyCost/cost : 0.0) << ")" << std::endl;
+  os << " ------------------------------------------------------------" << std::endl;
+}
@@ -0,0 +1,112 @@
+#include "NumaPlacement.hh"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+
+// NOTE: this is Unix specific!
+#include <dirent.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+namespace {
+  // parses a CPU list of the `/sys` files such as `0-15,32-47`
+  std::vector<int> ParseCPUList(const std::string& str) {
+    std::vector<int> cpus;
+    std::istringstream ss(str);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+      if (range.empty() || range == "\n") continue;
+      const size_t dash = range.find('-');
+      const int first = std::stoi(range.substr(0, dash));
+      const int last  = dash == std::string::npos ? first : std::stoi(range.substr(dash+1));
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    }
+    return cpus;
+  }
+}
+
+
+NumaPlacement::NumaPlacement() {
+  const std::string sysDir = "/sys/devices/system/node/";
+  if (DIR* dir = opendir(sysDir.c_str())) {
+    while (struct dirent* entry = readdir(dir)) {
+      const std::string name = entry->d_name;
+      if (name.compare(0, 4, "node") != 0 || name.size() < 5 || name.find_first_not_of("0123456789", 4) != std::string::npos) {
+        continue;
+      }
+      std::ifstream is(sysDir + name + "/cpulist");
+      std::string cpuList;
+      if (std::getline(is, cpuList)) {
+        Node node { std::stoi(name.substr(4)), ParseCPUList(cpuList) };
+        if (!node.fCPUs.empty()) {
+          fNodes.push_back(node);
+        }
+      }
+    }
+    closedir(dir);
+  }
+  // a single node with all CPUs if the topology is not available
+  if (fNodes.empty()) {
+    Node node { 0, {} };
+    for (int cpu = 0; cpu < static_cast<int>(std::max(1u, std::thread::hardware_concurrency())); ++cpu) {
+      node.fCPUs.push_back(cpu);
+    }
+    fNodes.push_back(node);
+  }
+  std::sort(fNodes.begin(), fNodes.end(), [](const Node& a, const Node& b) { return a.fID < b.fID; });
+  SelectNodes("all");
+}
+
+
+bool NumaPlacement::SelectNodes(const std::string& nodes) {
+  fSelected.clear();
+  if (nodes == "all") {
+    for (std::size_t i = 0; i < fNodes.size(); ++i) {
+      fSelected.push_back(i);
+    }
+    return true;
+  }
+  std::istringstream ss(nodes);
+  std::string id;
+  while (std::getline(ss, id, ':')) {
+    auto it = std::find_if(fNodes.begin(), fNodes.end(), [&](const Node& node) { return std::to_string(node.fID) == id; });
+    if (it == fNodes.end()) {
+      fSelected.clear();
+      return false;
+    }
+    fSelected.push_back(it - fNodes.begin());
+  }
+  return !fSelected.empty();
+}
+
+
+bool NumaPlacement::Pin(int node) const {
+#ifdef __linux__
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  for (int cpu : fNodes[fSelected[node]].fCPUs) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuSet);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+  (void)node;
+  return false;
+#endif
+}
+
+
+void NumaPlacement::Print(std::ostream& os) const {
+  os << " --- NumaPlacement: " << GetNumNodes() << " of the " << fNodes.size() << " NUMA nodes selected"
+     << (fReplicaLoader ? " (with a G4HepEm state replica per node)" : "") << std::endl;
+  for (int node = 0; node < GetNumNodes(); ++node) {
+    const std::vector<int>& cpus = fNodes[fSelected[node]].fCPUs;
+    os << "     - node " << GetNodeID(node) << ": " << cpus.size() << " CPUs (" << cpus.front() << " - " << cpus.back() << ")" << std::endl;
+  }
+}
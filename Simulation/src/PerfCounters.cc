@@ -0,0 +1,168 @@
+#include "PerfCounters.hh"
+
+#include <iomanip>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+
+// NOTE: this is Linux specific (not available otherwise)!
+#ifdef __linux__
+  #include <linux/perf_event.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+
+void PerfCounterData::Merge(const PerfCounterData& other) {
+  for (int ic = 0; ic < kNumCounters; ++ic) {
+    for (int ip = 0; ip < kNumPhases; ++ip) {
+      fCounts[ip][ic] += other.fCounts[ip][ic];
+    }
+    fAvailable[ic] = fAvailable[ic] || other.fAvailable[ic];
+  }
+}
+
+
+void PerfCounterData::Print(std::ostream& os) const {
+  static const char* phases[kNumPhases] = { "event loop", "  transport", "  end of event" };
+  static const char* counters[kNumCounters] = { "cycles", "instructions", "L1D-misses", "LLC-misses", "branch-misses" };
+  os << " --- Hardware performance counters ----------------------------- " << std::endl;
+  os << "  " << std::left << std::setw(16) << "phase" << std::right;
+  for (int ic = 0; ic < kNumCounters; ++ic) {
+    os << std::setw(16) << counters[ic];
+  }
+  os << std::setw(8) << "IPC" << std::setw(12) << "L1D/kinst" << std::setw(12) << "LLC/kinst" << std::setw(12) << "br/kinst" << std::endl;
+  for (int ip = 0; ip < kNumPhases; ++ip) {
+    os << "  " << std::left << std::setw(16) << phases[ip] << std::right;
+    for (int ic = 0; ic < kNumCounters; ++ic) {
+      if (fAvailable[ic]) {
+        os << std::setw(16) << fCounts[ip][ic];
+      } else {
+        os << std::setw(16) << "n/a";
+      }
+    }
+    const double inst = static_cast<double>(fCounts[ip][kInstructions]);
+    const bool   hasInst = fAvailable[kInstructions] && inst > 0.0;
+    os << std::fixed << std::setprecision(3);
+    if (hasInst && fAvailable[kCycles] && fCounts[ip][kCycles] > 0) {
+      os << std::setw(8) << inst/fCounts[ip][kCycles];
+    } else {
+      os << std::setw(8) << "n/a";
+    }
+    const int misses[3] = { kL1DMisses, kLLCMisses, kBranchMisses };
+    for (int im : misses) {
+      if (hasInst && fAvailable[im]) {
+        os << std::setw(12) << 1000.0*fCounts[ip][im]/inst;
+      } else {
+        os << std::setw(12) << "n/a";
+      }
+    }
+    os << std::defaultfloat << std::setprecision(6) << std::endl;
+  }
+  os << " ------------------------------------------------------------\n";
+}
+
+
+#ifdef __linux__
+
+namespace {
+  // the type and config of the counters (in the order of `PerfCounterData::ECounter`)
+  const std::uint32_t kTypes[PerfCounterData::kNumCounters] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE };
+  const std::uint64_t kConfigs[PerfCounterData::kNumCounters] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES };
+
+  // report only once (e.g. not for each worker thread) that the counters are not available
+  std::atomic<bool> gReported(false);
+}
+
+PerfCounters::PerfCounters() {
+  int err = 0;
+  for (int ic = 0; ic < PerfCounterData::kNumCounters; ++ic) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = kTypes[ic];
+    attr.config         = kConfigs[ic];
+    attr.disabled       = 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // the calling thread on any CPU
+    fFD[ic] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    if (fFD[ic] < 0 && err == 0) {
+      err = errno;
+    }
+  }
+  if (err != 0 && !gReported.exchange(true)) {
+    std::cerr << " *** PerfCounters: some (or all) hardware performance counters are not available ("
+              << std::strerror(err) << "): these are reported as n/a." << std::endl;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (int ic = 0; ic < PerfCounterData::kNumCounters; ++ic) {
+    if (fFD[ic] > -1) {
+      close(fFD[ic]);
+    }
+  }
+}
+
+void PerfCounters::Read(std::uint64_t* values) const {
+  for (int ic = 0; ic < PerfCounterData::kNumCounters; ++ic) {
+    values[ic] = 0;
+    if (fFD[ic] < 0) {
+      continue;
+    }
+    // value, time enabled and time running
+    std::uint64_t buf[3] = { 0, 0, 0 };
+    if (read(fFD[ic], buf, sizeof(buf)) != sizeof(buf)) {
+      continue;
+    }
+    values[ic] = (buf[2] > 0 && buf[2] < buf[1]) ? static_cast<std::uint64_t>(double(buf[0])*buf[1]/buf[2]) : buf[0];
+  }
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+  for (int ic = 0; ic < PerfCounterData::kNumCounters; ++ic) {
+    fFD[ic] = -1;
+  }
+  std::cerr << " *** PerfCounters: hardware performance counters are available only on Linux: these are reported as n/a." << std::endl;
+}
+
+PerfCounters::~PerfCounters() {}
+
+void PerfCounters::Read(std::uint64_t* values) const {
+  for (int ic = 0; ic < PerfCounterData::kNumCounters; ++ic) {
+    values[ic] = 0;
+  }
+}
+
+#endif // __linux__
+
+
+bool PerfCounters::IsAvailable() const {
+  for (int ic = 0; ic < PerfCounterData::kNumCounters; ++ic) {
+    if (fFD[ic] > -1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerfCounters::Accumulate(PerfCounterData& data, int phase, const std::uint64_t* start) const {
+  std::uint64_t now[PerfCounterData::kNumCounters];
+  Read(now);
+  for (int ic = 0; ic < PerfCounterData::kNumCounters; ++ic) {
+    if (fFD[ic] > -1) {
+      data.fCounts[phase][ic] += now[ic] > start[ic] ? now[ic] - start[ic] : 0;
+      data.fAvailable[ic] = true;
+    }
+  }
+}
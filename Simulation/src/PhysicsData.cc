@@ -0,0 +1,41 @@
+#include "PhysicsData.hh"
+
+#include "G4HepEmState.hh"
+#include "G4HepEmData.hh"
+#include "G4HepEmMatCutData.hh"
+#include "G4HepEmDataJsonIO.hh"
+
+#include "ResourceUsage.hh"
+
+#include <fstream>
+#include <iostream>
+
+
+G4HepEmState* LoadG4HepEmState(const std::string& fileName, const std::vector<int>& materialIndices, int verbose) {
+  const double startTime = GetWallTime();
+  std::ifstream jsonIS{ fileName.c_str() };
+  G4HepEmState* theState = jsonIS ? G4HepEmStateFromJson(jsonIS) : nullptr;
+  if (theState == nullptr || theState->fData == nullptr || theState->fData->fTheMatCutData == nullptr) {
+    std::cerr << " *** Cannot load the G4HepEm data from " << fileName
+              << " (a preset file is generated by `HepEmShow-DataGeneration -P`)" << std::endl;
+    return nullptr;
+  }
+  // each material-cuts index of the geometry must be mapped to a G4HepEm material-cuts couple
+  const G4HepEmMatCutData* theMatCutData = theState->fData->fTheMatCutData;
+  for (int indx : materialIndices) {
+    const int hepEmIMC = indx >= 0 && indx < theMatCutData->fNumG4MatCuts ? theMatCutData->fG4MCIndexToHepEmMCIndex[indx] : -1;
+    if (hepEmIMC < 0 || hepEmIMC >= theMatCutData->fNumMatCutData) {
+      std::cerr << " *** The G4HepEm data file " << fileName << " does not provide the material-cuts couple with index "
+                << indx << " used by the geometry (generate the data for the materials of the geometry)" << std::endl;
+      FreeG4HepEmData(theState->fData);
+      delete theState;
+      return nullptr;
+    }
+  }
+  if (verbose > 0) {
+    std::cout << " === G4HepEm data loaded from " << fileName << " in " << GetWallTime() - startTime << " [s]: "
+              << materialIndices.size() << " of the " << theMatCutData->fNumMatCutData
+              << " material-cuts couples are used by the geometry (peak RSS = " << GetPeakRSSMB() << " [MB])" << std::endl;
+  }
+  return theState;
+}
@@ -4,12 +4,29 @@
 #include "Results.hh"
 
 #include <cmath>
+#include <algorithm>
 
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 
 
+void InitResults(struct Results& res, int numLayers, const std::string& outputDir) {
+  res.fOutputDir = outputDir.empty() ? "" : outputDir + "/";
+  res.fEdepPerLayer.ReSet(res.fOutputDir + "hist_Edep_PerLayer", 0, numLayers, numLayers);
+  res.fEdepPerLayer_CurrentEvent.ReSet("hist_Edep_PerLayer_CurrentEvent", 0, numLayers, numLayers);
+  res.fEdepPerLayer_Acc.resize(numLayers);
+  #ifdef CODI_FORWARD
+    res.fEdepPerLayer_AccD.resize(numLayers);
+  #endif
+  #ifdef CODI_REVERSE
+    res.barEdep.resize(numLayers,0.);
+  #endif
+  res.fGammaTrackLenghtPerLayer.ReSet(res.fOutputDir + "hist_GamTrackL_PerLayer", 0, numLayers, numLayers);
+  res.fElPosTrackLenghtPerLayer.ReSet(res.fOutputDir + "hist_ElPosTrackL_PerLayer", 0, numLayers, numLayers);
+}
+
+
 void WriteResults(struct Results& res, int numEvents) {
   // for the histograms, bring them to be mean per event and write
   const G4double norm = numEvents > 0 ? 1.0/numEvents : 1.0;
@@ -19,23 +36,27 @@ void WriteResults(struct Results& res, int numEvents) {
 
   res.fEdepPerLayer.WriteToFile(false);
 
-  std::ofstream edeps("edeps");
-  for(int i=0; i<50; i++){
+  std::ofstream edeps(res.fOutputDir + "edeps");
+  for(size_t i=0; i<res.fEdepPerLayer_Acc.size(); i++){
      edeps << std::setprecision(14) << res.fEdepPerLayer_Acc[i].getMean() << " " << res.fEdepPerLayer_Acc[i].getMeanSq();
      #if CODI_FORWARD
+     if (res.fComputeDerivatives) {
         edeps << " " << res.fEdepPerLayer_AccD[i].getMean() << " " << res.fEdepPerLayer_AccD[i].getMeanSq();
+     }
      #endif
      edeps << "\n";
   }
   edeps.close();
 
   #ifdef CODI_REVERSE
-     std::ofstream barInputs("barInputs");
+  if (res.fComputeDerivatives) {
+     std::ofstream barInputs(res.fOutputDir + "barInputs");
      barInputs << std::setprecision(14);
      barInputs << res.barThicknessAbsorber.getMean() << " " << res.barThicknessAbsorber.getVar() << "\n";
      barInputs << res.barThicknessGap.getMean() << " " << res.barThicknessGap.getVar() << "\n";
      barInputs << res.barParticleEnergy.getMean() << " " << res.barParticleEnergy.getVar() << "\n";
      barInputs.close();
+  }
   #endif
 
 
@@ -72,7 +93,82 @@ void WriteResults(struct Results& res, int numEvents) {
   std::cout << " ------------------------------------------------------------\n";
 
   #ifdef CODI_REVERSE
+  if (res.fComputeDerivatives) {
+    // tape statistics per event (the tape is recorded and evaluated for each event)
+    const double numSteps = GET_VALUE(res.fNumStepsElPos + res.fNumStepsGamma)*GET_VALUE(norm);
+    const double tapeMem  = res.fTapeBytesPerEvent.getMean();
+    std::cout << std::setprecision(6);
+    std::cout << " Mean tape memory per event " << tapeMem/(1024.0*1024.0) << " [MB] ("
+              << (numSteps > 0 ? tapeMem/numSteps : 0.0) << " [B] per step)" << std::endl;
+    std::cout << " Mean reverse sweep time    " << res.fReverseTimePerEvent.getMean()*1000.0 << " [ms] per event" << std::endl;
+    std::cout << " ------------------------------------------------------------\n";
     G4double::getTape().printStatistics(std::cout);
+  }
+  #endif
+
+  if (res.fMeasurePerfCounters) {
+    res.fPerfCounterData.Print(std::cout);
+  }
+
+  #ifdef HEPEMSHOW_PHASE_TIMERS
+    res.fPhaseTimers.Print(std::cout);
+  #endif
+
+  #ifdef HEPEMSHOW_STEP_STATISTICS
+    res.fStepStatistics.WriteToFile(res.fOutputDir + "step_statistics");
+    res.fStepStatistics.Print(std::cout);
   #endif
 
+  #ifdef HEPEMSHOW_ALLOC_TRACKING
+    res.fAllocStatistics.Print(std::cout);
+  #endif
+
+}
+
+
+void MergeResults(struct Results& to, const struct Results& from) {
+  to.fEdepPerLayer.Add(&from.fEdepPerLayer);
+  for(size_t i=0; i<to.fEdepPerLayer_Acc.size(); i++){
+    to.fEdepPerLayer_Acc[i].merge(from.fEdepPerLayer_Acc[i]);
+    #ifdef CODI_FORWARD
+      to.fEdepPerLayer_AccD[i].merge(from.fEdepPerLayer_AccD[i]);
+    #endif
+  }
+  #ifdef CODI_REVERSE
+    to.barThicknessAbsorber.merge(from.barThicknessAbsorber);
+    to.barThicknessGap.merge(from.barThicknessGap);
+    to.barParticleEnergy.merge(from.barParticleEnergy);
+    to.fTapeBytesPerEvent.merge(from.fTapeBytesPerEvent);
+    to.fReverseTimePerEvent.merge(from.fReverseTimePerEvent);
+  #endif
+  to.fPerfCounterData.Merge(from.fPerfCounterData);
+  #ifdef HEPEMSHOW_PHASE_TIMERS
+    to.fPhaseTimers.Merge(from.fPhaseTimers);
+  #endif
+  #ifdef HEPEMSHOW_STEP_STATISTICS
+    to.fStepStatistics.Merge(from.fStepStatistics);
+  #endif
+  #ifdef HEPEMSHOW_ALLOC_TRACKING
+    to.fAllocStatistics.Merge(from.fAllocStatistics);
+  #endif
+  to.fPeakTrackStackDepth = std::max(to.fPeakTrackStackDepth, from.fPeakTrackStackDepth);
+  to.fGammaTrackLenghtPerLayer.Add(&from.fGammaTrackLenghtPerLayer);
+  to.fElPosTrackLenghtPerLayer.Add(&from.fElPosTrackLenghtPerLayer);
+  //
+  to.fEdepAbs         += from.fEdepAbs;
+  to.fEdepAbs2        += from.fEdepAbs2;
+  to.fEdepGap         += from.fEdepGap;
+  to.fEdepGap2        += from.fEdepGap2;
+  //
+  to.fNumSecGamma     += from.fNumSecGamma;
+  to.fNumSecGamma2    += from.fNumSecGamma2;
+  to.fNumSecElectron  += from.fNumSecElectron;
+  to.fNumSecElectron2 += from.fNumSecElectron2;
+  to.fNumSecPositron  += from.fNumSecPositron;
+  to.fNumSecPositron2 += from.fNumSecPositron2;
+  //
+  to.fNumStepsGamma   += from.fNumStepsGamma;
+  to.fNumStepsGamma2  += from.fNumStepsGamma2;
+  to.fNumStepsElPos   += from.fNumStepsElPos;
+  to.fNumStepsElPos2  += from.fNumStepsElPos2;
 }
@@ -0,0 +1,182 @@
+#include "ad_type.h"
+
+
+#include "RunReport.hh"
+
+#include "Results.hh"
+#include "ResourceUsage.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+
+namespace {
+  // JSON string (with the quotes and backslashes escaped)
+  std::string Quote(const std::string& str) {
+    std::string res = "\"";
+    for (char c : str) {
+      if (c == '"' || c == '\\') res += '\\';
+      res += c;
+    }
+    return res + "\"";
+  }
+
+  // JSON number (`null` if not finite)
+  std::string Number(double val) {
+    if (!std::isfinite(val)) {
+      return "null";
+    }
+    std::ostringstream ss;
+    ss.precision(10);
+    ss << val;
+    return ss.str();
+  }
+
+  // JSON boolean
+  const char* Bool(bool val) {
+    return val ? "true" : "false";
+  }
+}
+
+
+constexpr int RunReport::kSchemaVersion;
+
+
+void RunReport::AddParameter(const std::string& name, const std::string& value) {
+  fParameters.emplace_back(name, Quote(value));
+}
+
+void RunReport::AddParameter(const std::string& name, double value) {
+  fParameters.emplace_back(name, Number(value));
+}
+
+
+
+void WriteRunReport(const std::string& fileName, const RunReport& report, const Results& res, int numEvents) {
+  std::ofstream os(fileName);
+  if (!os) {
+    std::cerr << "\n ***** ERROR in WriteRunReport  "
+              << " cannot create the file = " << fileName
+              << std::endl;
+    exit(1);
+  }
+  const double norm     = numEvents > 0 ? 1.0/numEvents : 0.0;
+  // the throughput of one configuration: the wall time is shared by all configurations of the events
+  const double wallTime = report.fWallTime > 0.0 ? report.fWallTime/std::max(1, report.fNumConfigs) : NAN;
+  const double stepsGam = GET_VALUE(res.fNumStepsGamma);
+  const double stepsEl  = GET_VALUE(res.fNumStepsElPos);
+  // build
+  os << "{\n";
+  os << "  \"schema\": \"hepemshow-run-report\",\n";
+  os << "  \"schemaVersion\": " << RunReport::kSchemaVersion << ",\n";
+  os << "  \"build\": {\n";
+  #if defined(CODI_FORWARD)
+    os << "    \"adMode\": \"forward\",\n";
+  #elif defined(CODI_REVERSE)
+    os << "    \"adMode\": \"reverse\",\n";
+  #else
+    os << "    \"adMode\": \"primal\",\n";
+  #endif
+  bool phaseTimers = false, stepStatistics = false, allocTracking = false;
+  #ifdef HEPEMSHOW_PHASE_TIMERS
+    phaseTimers = true;
+  #endif
+  #ifdef HEPEMSHOW_STEP_STATISTICS
+    stepStatistics = true;
+  #endif
+  #ifdef HEPEMSHOW_ALLOC_TRACKING
+    allocTracking = true;
+  #endif
+  os << "    \"phaseTimers\": " << Bool(phaseTimers) << ",\n";
+  os << "    \"stepStatistics\": " << Bool(stepStatistics) << ",\n";
+  os << "    \"allocTracking\": " << Bool(allocTracking) << "\n";
+  os << "  },\n";
+  // input parameters
+  os << "  \"parameters\": {\n";
+  for (std::size_t i = 0; i < report.fParameters.size(); ++i) {
+    os << "    " << Quote(report.fParameters[i].first) << ": " << report.fParameters[i].second
+       << (i+1 < report.fParameters.size() ? ",\n" : "\n");
+  }
+  os << "  },\n";
+  // performance
+  os << "  \"performance\": {\n";
+  os << "    \"runMode\": " << Quote(report.fRunMode) << ",\n";
+  os << "    \"numThreads\": " << report.fNumThreads << ",\n";
+  os << "    \"numEvents\": " << numEvents << ",\n";
+  os << "    \"configurationsPerEvent\": " << report.fNumConfigs << ",\n";
+  os << "    \"wallTime_s\": " << Number(report.fWallTime) << ",\n";
+  os << "    \"cpuTime_s\": " << Number(report.fCPUTime) << ",\n";
+  os << "    \"eventsPerSecond\": " << Number(numEvents/wallTime) << ",\n";
+  os << "    \"eventsPerSecondAllConfigurations\": " << Number(report.fWallTime > 0.0 ? numEvents/report.fWallTime : NAN) << ",\n";
+  os << "    \"stepsPerSecond\": { \"gamma\": " << Number(stepsGam/wallTime) << ", \"e-/e+\": " << Number(stepsEl/wallTime)
+     << ", \"all\": " << Number((stepsGam + stepsEl)/wallTime) << " },\n";
+  os << "    \"peakRSS_MB\": " << Number(GetPeakRSSMB()) << ",\n";
+  os << "    \"peakTrackStackDepth\": " << res.fPeakTrackStackDepth << "\n";
+  os << "  },\n";
+  // physics summary (per event)
+  const double edepAbs = GET_VALUE(res.fEdepAbs)*norm;
+  const double edepGap = GET_VALUE(res.fEdepGap)*norm;
+  const double rmsAbs  = std::sqrt(std::abs(GET_VALUE(res.fEdepAbs2)*norm - edepAbs*edepAbs));
+  const double rmsGap  = std::sqrt(std::abs(GET_VALUE(res.fEdepGap2)*norm - edepGap*edepGap));
+  os << "  \"physics\": {\n";
+  os << "    \"edepAbsorber_MeV\": { \"mean\": " << Number(edepAbs) << ", \"stdDev\": " << Number(rmsAbs) << " },\n";
+  os << "    \"edepGap_MeV\": { \"mean\": " << Number(edepGap) << ", \"stdDev\": " << Number(rmsGap) << " },\n";
+  os << "    \"meanSecondaries\": { \"gamma\": " << Number(GET_VALUE(res.fNumSecGamma)*norm)
+     << ", \"e-\": " << Number(GET_VALUE(res.fNumSecElectron)*norm)
+     << ", \"e+\": " << Number(GET_VALUE(res.fNumSecPositron)*norm) << " },\n";
+  os << "    \"meanSteps\": { \"gamma\": " << Number(stepsGam*norm) << ", \"e-/e+\": " << Number(stepsEl*norm) << " },\n";
+  const int numLayers = std::min<int>(res.fEdepPerLayer.GetNumBins(), res.fEdepPerLayer_Acc.size());
+  std::string means, errors;
+  for (int i = 0; i < numLayers; ++i) {
+    const Accumulator<double>& acc = res.fEdepPerLayer_Acc[i];
+    const double mean = numEvents > 0 ? acc.getMean() : NAN;
+    const double err  = numEvents > 0 ? std::sqrt(std::max(0.0, acc.getVar())*norm) : NAN;
+    means  += (i > 0 ? ", " : "") + Number(mean);
+    errors += (i > 0 ? ", " : "") + Number(err);
+  }
+  os << "    \"edepPerLayer_MeV\": { \"mean\": [" << means << "], \"stdErr\": [" << errors << "] }\n";
+  os << "  },\n";
+  // reverse-mode AD tape statistics (per event)
+  #ifdef CODI_REVERSE
+  if (res.fComputeDerivatives && numEvents > 0) {
+    const double tapeMem = res.fTapeBytesPerEvent.getMean();
+    const double steps   = (stepsGam + stepsEl)*norm;
+    os << "  \"tape\": {\n";
+    os << "    \"bytesPerEvent\": " << Number(tapeMem) << ",\n";
+    os << "    \"bytesPerStep\": " << Number(steps > 0 ? tapeMem/steps : NAN) << ",\n";
+    os << "    \"reverseTimePerEvent_s\": " << Number(res.fReverseTimePerEvent.getMean()) << "\n";
+    os << "  },\n";
+  } else {
+    os << "  \"tape\": null,\n";
+  }
+  #else
+    os << "  \"tape\": null,\n";
+  #endif
+  // hardware performance counters (accumulated over the threads)
+  if (res.fMeasurePerfCounters) {
+    static const char* phases[PerfCounterData::kNumPhases] = { "eventLoop", "transport", "endOfEvent" };
+    static const char* counters[PerfCounterData::kNumCounters] = { "cycles", "instructions", "l1dMisses", "llcMisses", "branchMisses" };
+    const PerfCounterData& data = res.fPerfCounterData;
+    os << "  \"perfCounters\": {\n";
+    for (int ip = 0; ip < PerfCounterData::kNumPhases; ++ip) {
+      os << "    " << Quote(phases[ip]) << ": {";
+      for (int ic = 0; ic < PerfCounterData::kNumCounters; ++ic) {
+        os << (ic > 0 ? ", " : " ") << Quote(counters[ic]) << ": ";
+        if (data.fAvailable[ic]) {
+          os << data.fCounts[ip][ic];
+        } else {
+          os << "null";
+        }
+      }
+      os << " }" << (ip+1 < PerfCounterData::kNumPhases ? ",\n" : "\n");
+    }
+    os << "  }\n";
+  } else {
+    os << "  \"perfCounters\": null\n";
+  }
+  os << "}\n";
+}
@@ -19,6 +19,8 @@
 #include "Geometry.hh"
 #include "Box.hh"
 #include "Results.hh"
+#include "PhaseTimers.hh"
+#include "StepStatistics.hh"
 
 
 
@@ -48,6 +50,7 @@ void SteppingLoop::GammaStepper(G4HepEmTLData& theTLData, G4HepEmState& theState
   int  indxAbs       = -1;
   G4double  localPosition[3];
   while (theTrack->GetEKin() > 0.0) {
+    HEPEMSHOW_STEP_BEGIN(GET_VALUE(theTrack->GetEKin()));
     // calculate distance to boundary from the pre-step point: will locate the pont
     // NOTE: this should never be zero as zero means that the point is outside of the volume
     //       (taking into account the direction and tolerance)
@@ -56,13 +59,17 @@ void SteppingLoop::GammaStepper(G4HepEmTLData& theTLData, G4HepEmState& theState
     G4double* curDirection   = theTrack->GetDirection();
     // set the local position = global position (will be local after CalculateDistanceToOut)
     Set3Vect(localPosition, globalPosition);
+    HEPEMSHOW_PHASE_BEGIN(kPhaseNavigation);
     const G4double distToBoundary = theGeometry.CalculateDistanceToOut(localPosition, curDirection, &currentVolume, &indxLayer, &indxAbs);
+    HEPEMSHOW_PHASE_END(kPhaseNavigation);
     // STOP HERE IF `distToBoundary = 1.0E+20` i.e. we are going out from the Calorimeter
     if (distToBoundary > 1.0E+10) {
       return;
     }
     // calculate pre-step point safety
+    HEPEMSHOW_PHASE_BEGIN(kPhaseSafety);
     const G4double preStepSafety  = currentVolume->DistanceToOut(localPosition);
+    HEPEMSHOW_PHASE_END(kPhaseSafety);
     bool onBoundary = (preStepSafety == 0.0);
     // get the material-cuts couple index from the volume
     const int indxMaterial = currentVolume->GetMaterialIndx();
@@ -76,7 +83,9 @@ void SteppingLoop::GammaStepper(G4HepEmTLData& theTLData, G4HepEmState& theState
     // NOTE: 1. result of step limit will be written into `theTLData` PrimaryTrack HepEmTrack object
     //       2. the result is the straight line distance that the photon needs to travel along the current
     //          direction till the next physics interaction (assuming the same material along)
+    HEPEMSHOW_PHASE_BEGIN(kPhaseHowFar);
     G4HepEmGammaManager::HowFar(theState.fData, theState.fParameters, &theTLData);
+    HEPEMSHOW_PHASE_END(kPhaseHowFar);
     const G4double distToPhysics = theTrack->GetGStepLength();
     //
     // take the shortest from the geometry and the physics step limits as the current (straight line) step length
@@ -93,6 +102,7 @@ void SteppingLoop::GammaStepper(G4HepEmTLData& theTLData, G4HepEmState& theState
     if (stepLength==0.0) {
       stepLength = 1.0E-6;
       AddTo3Vect(globalPosition, curDirection, stepLength);
+      HEPEMSHOW_STEP_END(0, indxMaterial, kStepLimiterPush);
       continue;
     }
     // move the track to the corresponding post-step point
@@ -106,14 +116,20 @@ void SteppingLoop::GammaStepper(G4HepEmTLData& theTLData, G4HepEmState& theState
     //  - in case of boundary limited steps: no physics interaction just update
     //       of the `number of interaction left` based on the current step length
     //  - in case of physics limited step: interaction happens additionaly
+    HEPEMSHOW_PHASE_BEGIN(kPhasePerform);
     G4HepEmGammaManager::Perform(theState.fData, theState.fParameters, &theTLData);
+    HEPEMSHOW_PHASE_END(kPhasePerform);
     //
     // Take and stack all secondaries (if any) that has been produced.
     if (theTLData.GetNumSecondaryElectronTrack() + theTLData.GetNumSecondaryGammaTrack() > 0 ) {
+      HEPEMSHOW_PHASE_SCOPE(kPhaseStackSecondaries);
       StackSecondaries(theTLData, theTrackStack, *theTrack);
     }
     // call the SteppingAction (whenever a step was done in the calorimeter)
+    HEPEMSHOW_PHASE_BEGIN(kPhaseSteppingAction);
     SteppingAction(theResult, *theTrack, currentVolume, stepLength, indxLayer, indxAbs, eventID, numStep);
+    HEPEMSHOW_PHASE_END(kPhaseSteppingAction);
+    HEPEMSHOW_STEP_END(0, indxMaterial, onBoundary ? kStepLimiterGeometry : kStepLimiterPhysics);
 
     ++numStep;
   }
@@ -141,6 +157,7 @@ void SteppingLoop::ElectronStepper(G4HepEmTLData& theTLData, G4HepEmState& theSt
   // keep tracking while the kinetic energy drops to zero (i.e. e-/e+ lose all its energy; e+ annihilates)
   // unless the track is going out of the Calorimeter
   while (theTrack->GetEKin() > 0.0) {
+    HEPEMSHOW_STEP_BEGIN(GET_VALUE(theTrack->GetEKin()));
     // calculate distance to boundary from the pre-step point: will locate the pont
     // NOTE: this should never be zero as zero means that the point is outside of the volume
     //       (taking into account the direction and tolerance)
@@ -149,14 +166,18 @@ void SteppingLoop::ElectronStepper(G4HepEmTLData& theTLData, G4HepEmState& theSt
     G4double* curDirection   = theTrack->GetDirection();
     // set the local position = global position (will be local after CalculateDistanceToOut)
     Set3Vect(localPosition, globalPosition);
+    HEPEMSHOW_PHASE_BEGIN(kPhaseNavigation);
     const G4double distToBoundary = theGeometry.CalculateDistanceToOut(localPosition, curDirection, &currentVolume, &indxLayer, &indxAbs);
+    HEPEMSHOW_PHASE_END(kPhaseNavigation);
     // STOP HERE IF `distToBoundary = 1.0E+20` i.e. we are going out from the Calorimeter
     if (distToBoundary > 1.0E+10) {
       return;
     }
     // at the pre-step point: calculate safety and check if on-boundary (use only if we do not know that the
     // previous step ended up on boundary i.e. use only in the very first or pushed steps)
+    HEPEMSHOW_PHASE_BEGIN(kPhaseSafety);
     G4double safety   = currentVolume->DistanceToOut(localPosition);
+    HEPEMSHOW_PHASE_END(kPhaseSafety);
     bool onBoundary = numStep == 0 ? (safety<5.0E-10) : wasOnBoundary;
     const G4double preStepSafety = onBoundary ? 0.0 : safety;
 
@@ -180,7 +201,9 @@ void SteppingLoop::ElectronStepper(G4HepEmTLData& theTLData, G4HepEmState& theSt
     //          due to MSC
     //       4. also note, that the real length (physical) of the step is longer than the straight light along the
     //          original direction (geometrical) step length due to MSC
+    HEPEMSHOW_PHASE_BEGIN(kPhaseHowFar);
     G4HepEmElectronManager::HowFar(theState.fData, theState.fParameters, &theTLData);
+    HEPEMSHOW_PHASE_END(kPhaseHowFar);
     const G4double distToPhysics = theTrack->GetGStepLength();
     //
     // take the shortest from the geometry and physics step limits as current (straight line) step length
@@ -200,6 +223,7 @@ void SteppingLoop::ElectronStepper(G4HepEmTLData& theTLData, G4HepEmState& theSt
 //      wasPushed  = true;
       stepLength = 1.0E-6;
       AddTo3Vect(globalPosition, curDirection, stepLength);
+      HEPEMSHOW_STEP_END(StepStatistics::ParticleIndex(GET_VALUE(theTrack->GetCharge())), indxMaterial, kStepLimiterPush);
       continue;
     }
     // move the track to the corresponding post-step point
@@ -225,7 +249,9 @@ void SteppingLoop::ElectronStepper(G4HepEmTLData& theTLData, G4HepEmState& theSt
     // keep the original direction as it will be changed during the physics (even without discrete interaction due to MSC)
     G4double orgDirection[3];
     Set3Vect(orgDirection, curDirection);
+    HEPEMSHOW_PHASE_BEGIN(kPhasePerform);
     G4HepEmElectronManager::Perform(theState.fData, theState.fParameters, &theTLData);
+    HEPEMSHOW_PHASE_END(kPhasePerform);
     // take the real, i.e. physical step length (only if MSC is active in G4HepEmElectronManager because the
     // physical step length stays zero when MSC is not active as physical = geometrical in that case)
     const G4double pStepLength = theMSCData->fTrueStepLength > 0.0 ? theMSCData->fTrueStepLength : stepLength;
@@ -233,6 +259,7 @@ void SteppingLoop::ElectronStepper(G4HepEmTLData& theTLData, G4HepEmState& theSt
     // get the displacement and check if we need to apply (should not if the energy is zero but ok keep its simply)
     // we apply it if its length is lonegr than a minimum and we are not on boudnry (i.e. the current post-step point)
     if (!onBoundary) {
+      HEPEMSHOW_PHASE_SCOPE(kPhaseMSCDisplacement);
       const G4double* displacement    = theMSCData->GetDisplacement();
       const G4double  dLength2        = displacement[0]*displacement[0] + displacement[1]*displacement[1] + displacement[2]*displacement[2];
       const G4double  kGeomMinLength  = 5.0e-8;  // 0.05 [nm]
@@ -268,10 +295,14 @@ void SteppingLoop::ElectronStepper(G4HepEmTLData& theTLData, G4HepEmState& theSt
     //
     // stack all secondaries (if any) that has been produced in this step
     if (theTLData.GetNumSecondaryElectronTrack() + theTLData.GetNumSecondaryGammaTrack() > 0 ) {
+      HEPEMSHOW_PHASE_SCOPE(kPhaseStackSecondaries);
       StackSecondaries(theTLData, theTrackStack, *theTrack);
     }
 
+    HEPEMSHOW_PHASE_BEGIN(kPhaseSteppingAction);
     SteppingAction(theResult, *theTrack, currentVolume, pStepLength, indxLayer, indxAbs, eventID, numStep);
+    HEPEMSHOW_PHASE_END(kPhaseSteppingAction);
+    HEPEMSHOW_STEP_END(StepStatistics::ParticleIndex(GET_VALUE(theTrack->GetCharge())), indxMaterial, onBoundary ? kStepLimiterGeometry : kStepLimiterPhysics);
 
     ++numStep;
   }
@@ -0,0 +1,109 @@
+#include "ad_type.h"
+
+
+#include "StoppingRule.hh"
+
+#include "Results.hh"
+#include "ResourceUsage.hh"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+
+StoppingRule::StoppingRule(double targetRelError, double timeBudget, const std::vector<int>& layers, bool derivatives, int batchSize)
+: fTargetRelError(targetRelError),
+  fTimeBudget(timeBudget),
+  fLayers(layers),
+  fDerivatives(derivatives),
+  fBatchSize(std::max(1, batchSize)),
+  fStartTime(0.0),
+  fMaxRelError(std::numeric_limits<double>::infinity()),
+  fReason(kMaxEvents) {}
+
+
+void StoppingRule::Start(int numWorkers) {
+  fWorkerAccs.clear();
+  fWorkerAccs.resize(std::max(1, numWorkers));
+  fMaxRelError = std::numeric_limits<double>::infinity();
+  fReason      = kMaxEvents;
+  fStartTime   = GetWallTime();
+}
+
+
+std::vector<Accumulator<double>> StoppingRule::Select(const Results& theResult) const {
+  std::vector<Accumulator<double>> accs;
+  #if defined(CODI_REVERSE)
+    // the bar values of the inputs (independent of the layers)
+    if (fDerivatives) {
+      accs.push_back(theResult.barThicknessAbsorber);
+      accs.push_back(theResult.barThicknessGap);
+      accs.push_back(theResult.barParticleEnergy);
+      return accs;
+    }
+  #endif
+  const std::vector<Accumulator<double>>* perLayer = &theResult.fEdepPerLayer_Acc;
+  #if defined(CODI_FORWARD)
+    if (fDerivatives) {
+      perLayer = &theResult.fEdepPerLayer_AccD;
+    }
+  #endif
+  const int numLayers = std::min<int>(theResult.fEdepPerLayer.GetNumBins(), perLayer->size());
+  if (fLayers.empty()) {
+    accs.assign(perLayer->begin(), perLayer->begin() + numLayers);
+  } else {
+    for (int il : fLayers) {
+      if (il > -1 && il < numLayers) {
+        accs.push_back((*perLayer)[il]);
+      }
+    }
+  }
+  return accs;
+}
+
+
+bool StoppingRule::Check(int workerID, const Results& theResult) {
+  std::vector<Accumulator<double>> accs = Select(theResult);
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (fReason != kMaxEvents) {
+    return true;
+  }
+  // time budget
+  if (fTimeBudget > 0.0 && GetWallTime() - fStartTime >= fTimeBudget) {
+    fReason = kTimeBudget;
+  }
+  // precision: on the accumulators of all workers
+  fWorkerAccs[workerID] = std::move(accs);
+  if (fTargetRelError > 0.0) {
+    std::vector<Accumulator<double>> merged = fWorkerAccs[workerID];
+    for (std::size_t iw = 0; iw < fWorkerAccs.size(); ++iw) {
+      if (iw == static_cast<std::size_t>(workerID)) continue;
+      for (std::size_t ia = 0; ia < std::min(merged.size(), fWorkerAccs[iw].size()); ++ia) {
+        merged[ia].merge(fWorkerAccs[iw][ia]);
+      }
+    }
+    double maxRelError = merged.empty() ? std::numeric_limits<double>::infinity() : 0.0;
+    for (const Accumulator<double>& acc : merged) {
+      const double n    = static_cast<double>(acc.getCount());
+      const double mean = n > 0 ? std::abs(acc.getMean()) : 0.0;
+      const double err  = n > 1 && mean > 0.0 ? std::sqrt(std::max(0.0, acc.getVar())/n)/mean : std::numeric_limits<double>::infinity();
+      maxRelError = std::max(maxRelError, err);
+    }
+    fMaxRelError = maxRelError;
+    if (fReason == kMaxEvents && fMaxRelError <= fTargetRelError) {
+      fReason = kPrecision;
+    }
+  }
+  return fReason != kMaxEvents;
+}
+
+
+void StoppingRule::Print(std::ostream& os) const {
+  static const char* reasons[3] = { "maximum number of events", "target precision", "time budget" };
+  os << " --- StoppingRule: the event loop was terminated by the " << reasons[fReason]
+     << " (elapsed time: " << GetWallTime() - fStartTime << " [s]";
+  if (fTargetRelError > 0.0) {
+    os << ", largest relative standard error: " << fMaxRelError << " (target: " << fTargetRelError << ")";
+  }
+  os << ")" << std::endl;
+}
@@ -0,0 +1,131 @@
+#include "Timeline.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+bool Timeline::gEnabled = false;
+bool Timeline::gTracks  = false;
+thread_local std::uint64_t Timeline::tStart[3] = { 0, 0, 0 };
+constexpr std::size_t Timeline::kInitialCapacity;
+constexpr std::size_t Timeline::kCapacity;
+
+namespace {
+  // one recorded span
+  struct TraceRecord {
+    std::uint64_t fStart;  // [ns] since the timeline was enabled
+    std::uint64_t fEnd;
+    int           fKind;
+    int           fID;
+    int           fType;
+  };
+
+  // the ring buffer of one thread: written only by its thread (the number of
+  // records is not bounded, the record `i` is at `i % Timeline::kCapacity`, and
+  // the records are appended till the buffer reaches its maximum size)
+  struct ThreadBuffer {
+    int                      fThreadID;
+    std::string              fName;
+    std::vector<TraceRecord> fRecords;
+    std::uint64_t            fNumRecords{0};
+  };
+
+  std::chrono::steady_clock::time_point      gOrigin;
+  // all buffers (kept till the end of the run, i.e. after their threads finished)
+  std::vector<std::unique_ptr<ThreadBuffer>> gBuffers;
+  std::mutex                                 gBuffersMutex;
+  thread_local ThreadBuffer*                 tBuffer = nullptr;
+
+  // the buffer of the calling thread: registered at its first use
+  ThreadBuffer& GetThreadBuffer() {
+    if (tBuffer == nullptr) {
+      std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+      buffer->fRecords.reserve(Timeline::kInitialCapacity);
+      std::lock_guard<std::mutex> lock(gBuffersMutex);
+      buffer->fThreadID = static_cast<int>(gBuffers.size());
+      buffer->fName     = "thread #" + std::to_string(buffer->fThreadID);
+      tBuffer = buffer.get();
+      gBuffers.push_back(std::move(buffer));
+    }
+    return *tBuffer;
+  }
+}
+
+
+void Timeline::Enable(bool withTracks) {
+  gOrigin  = std::chrono::steady_clock::now();
+  gEnabled = true;
+  gTracks  = withTracks;
+}
+
+
+std::uint64_t Timeline::Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gOrigin).count();
+}
+
+
+void Timeline::SetThreadName(const std::string& name) {
+  if (gEnabled) {
+    GetThreadBuffer().fName = name;
+  }
+}
+
+
+void Timeline::Record(int kind, std::uint64_t start, int id, int type) {
+  ThreadBuffer& buffer = GetThreadBuffer();
+  if (buffer.fNumRecords < kCapacity) {
+    buffer.fRecords.emplace_back();
+  }
+  TraceRecord& rec = buffer.fRecords[buffer.fNumRecords % kCapacity];
+  rec.fStart = start;
+  rec.fEnd   = Now();
+  rec.fKind  = kind;
+  rec.fID    = id;
+  rec.fType  = type;
+  ++buffer.fNumRecords;
+}
+
+
+void Timeline::Write(const std::string& fileName) {
+  static const char* kinds[3]  = { "event", "track", "output" };
+  static const char* tracks[3] = { "gamma", "e-", "e+" };
+  FILE* f = fopen(fileName.c_str(), "w");
+  if (!f) {
+    std::cerr << "\n ***** ERROR in Timeline::Write  "
+              << " cannot create the file = " << fileName
+              << std::endl;
+    exit(1);
+  }
+  std::lock_guard<std::mutex> lock(gBuffersMutex);
+  fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"HepEmShow\"}}");
+  std::uint64_t numLost = 0;
+  for (const auto& buffer : gBuffers) {
+    fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            buffer->fThreadID, buffer->fName.c_str());
+    fprintf(f, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+            buffer->fThreadID, buffer->fThreadID);
+    // the oldest kept record is the first (ring buffer)
+    const std::uint64_t num   = std::min<std::uint64_t>(buffer->fNumRecords, kCapacity);
+    const std::uint64_t first = buffer->fNumRecords - num;
+    numLost += first;
+    for (std::uint64_t i = first; i < buffer->fNumRecords; ++i) {
+      const TraceRecord& rec = buffer->fRecords[i % kCapacity];
+      const char* name = rec.fKind == kTrack ? tracks[rec.fType] : kinds[rec.fKind];
+      // complete ("X") events with time stamps and durations in [us]
+      fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"id\":%d}}",
+              name, kinds[rec.fKind], buffer->fThreadID, 1.0E-3*rec.fStart, 1.0E-3*(rec.fEnd - rec.fStart), rec.fID);
+    }
+  }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+  if (numLost > 0) {
+    std::cerr << " *** Timeline::Write: the " << numLost << " oldest records were overwritten (ring buffer of "
+              << kCapacity << " records per thread)." << std::endl;
+  }
+}
@@ -0,0 +1,46 @@
+#include "ToolSetup.hh"
+
+#include "Geometry.hh"
+#include "PrimaryGenerator.hh"
+
+#include <iostream>
+#include <cstdlib>
+
+
+bool IsValidParticleName(const std::string& name) {
+  return name == "e-" || name == "e+" || name == "gamma";
+}
+
+
+void CheckParticleName(const std::string& name, void (*help)()) {
+  if (!IsValidParticleName(name)) {
+    std::cout << "\n *** Unknown primary particle name -p: " << name << std::endl;
+    help();
+    exit(-1);
+  }
+}
+
+
+std::string G4HepEmDataFileName(const std::string& name) {
+  return name.find(".json") == std::string::npos ? name + ".json" : name;
+}
+
+
+double ParticleCharge(const std::string& name) {
+  return name == "e-" ? -1.0 : (name == "gamma" ? 0.0 : +1.0);
+}
+
+
+void SetUpGeometry(Geometry& theGeometry, int numLayers, G4double thickAbs, G4double thickGap) {
+  theGeometry.SetNumLayers(numLayers);
+  theGeometry.SetAbsThick(thickAbs);
+  theGeometry.SetGapThick(thickGap);
+}
+
+
+void SetUpPrimaryGenerator(PrimaryGenerator& thePrimaryGenerator, const std::string& particleName, G4double energy, const Geometry& theGeometry) {
+  thePrimaryGenerator.SetCharge(ParticleCharge(particleName));
+  thePrimaryGenerator.SetKinEnergy(energy);
+  thePrimaryGenerator.SetPosition(theGeometry.GetPrimaryXposition(), 0.0, 0.0);
+  thePrimaryGenerator.SetDirection(1.0, 0.0, 0.0);
+}
@@ -8,7 +8,8 @@
 TrackStack::TrackStack()
 : fSize(16),
   fCurIndx(-1),
-  fCurrentTrackID(0) {
+  fCurrentTrackID(0),
+  fPeakDepth(0) {
   fTrackVect.resize(fSize);
 }
 
@@ -40,12 +41,28 @@ G4HepEmTrack& TrackStack::Insert() {
     fSize *= 2;
     fTrackVect.resize(fSize);
   }
+  if (fCurIndx==fPeakDepth) {
+    fPeakDepth = fCurIndx+1;
+  }
   // retrun a eference to the next avaiable secondary track
   fTrackVect[fCurIndx].ReSet();
   return fTrackVect[fCurIndx];
 }
 
 
+int TrackStack::MoveInto(TrackStack& to) {
+  // the bottom track first so the tracks are popped from `to` in the same order as from this
+  const int numTracks = fCurIndx+1;
+  for (int i = 0; i < numTracks; ++i) {
+    G4HepEmTrack& track = to.Insert();
+    Copy(fTrackVect[i], track);
+    track.SetID(to.GetNextTrackID());
+  }
+  fCurIndx = -1;
+  return numTracks;
+}
+
+
 void TrackStack::Copy(G4HepEmTrack& from, G4HepEmTrack& to) {
   to.ReSet();
   to.SetPosition(from.GetPosition());
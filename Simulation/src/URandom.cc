@@ -15,3 +15,16 @@ URandom::~URandom() {
 G4double URandom::flat() {
   return fDist->operator()(fEngine);
 }
+
+void URandom::SetSeed(std::uint64_t seed) {
+  fEngine.seed(seed);
+  fDist->reset();
+}
+
+std::uint64_t URandom::EventSeed(std::uint64_t runSeed, int eventID) {
+  // SplitMix64 finaliser on the combined run seed and event ID
+  std::uint64_t z = runSeed + 0x9E3779B97F4A7C15ULL * (static_cast<std::uint64_t>(eventID) + 1);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}